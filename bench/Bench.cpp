@@ -0,0 +1,275 @@
+#include <cinttypes>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Searcher.hpp"
+#include "SIMD.hpp"
+#include "Horspool.hpp"
+#include "TwoWay.hpp"
+#include "AhoCorasick.hpp"
+#include "Regex.hpp"
+#include "Output.hpp"
+#include "Walker.hpp"
+
+// Измерение пропускной способности поиска на сгенерированном корпусе файлов.
+// Для каждого набора файлов, алгоритма поиска, режима обхода и числа потоков измеряется время
+// выполнения (по настенным часам), скорость в ГБ/с и файлах/с и ускорение относительно одного потока.
+// Результаты выводятся в формате JSON (по одному объекту на измерение), чтобы их можно было
+// сравнивать между версиями.
+//
+// Использование: psearch_bench [--corpus <dir>] [--seed <n>] [--scale <x>] [--threads <n,n,...>] [--repeat <n>]
+
+// Образцы, которые ищутся во всех наборах файлов.
+const std::string needle = "psearch_needle";
+const std::vector<std::string> needles = {"psearch_needle", "quartz_marker", "zephyr_token", "obsidian_key"};
+const std::string expression = "psearch_[a-z]+e";
+
+// Слова для генерации текста.
+const std::vector<std::string> words =
+{
+    "alpha", "beta", "gamma", "delta", "lorem", "ipsum", "dolor", "sit", "amet", "search", "thread",
+    "queue", "file", "line", "value", "return", "const", "static", "int", "void", "string", "vector",
+    "error", "warning", "info", "debug", "request", "response", "server", "client", "0x7f", "42",
+};
+
+// Параметры набора файлов.
+struct CorpusSpec
+{
+    std::string name;   // Название набора.
+    size_t directories; // Число директорий (для deep - число цепочек).
+    size_t depth;       // Глубина цепочек директорий.
+    size_t files;       // Число файлов в каждой директории.
+    size_t file_size;   // Размер файла в байтах.
+    double density;     // Вероятность вхождения образца в строку.
+    bool binary;        // Файлы из случайных байт.
+};
+
+// Описание сгенерированного набора файлов.
+struct Corpus
+{
+    std::string name;
+    std::filesystem::path path;
+    size_t files = 0;
+    uintmax_t bytes = 0;
+};
+
+// Генерация содержимого файла. Используются только значения mt19937_64 (без распределений
+// стандартной библиотеки), поэтому корпус одинаков для одного seed на любой платформе.
+std::string generate_file(std::mt19937_64& random, const CorpusSpec& spec)
+{
+    std::string data;
+    data.reserve(spec.file_size + 256);
+    const uint64_t threshold = static_cast<uint64_t>(spec.density * 1e9);
+    while (data.size() < spec.file_size)
+    {
+        if (spec.binary)
+        {
+            // Случайные байты с редкими вставками образца.
+            for (size_t i = 0; i < 64; ++i) { data.push_back(static_cast<char>(random() & 0xFF)); }
+            if (random() % 1000000000 < threshold) { data += needle; }
+            continue;
+        }
+
+        const size_t line_words = 4 + random() % 12;
+        for (size_t i = 0; i < line_words; ++i)
+        {
+            if (i) { data.push_back(' '); }
+            data += words[random() % words.size()];
+        }
+        if (random() % 1000000000 < threshold)
+        {
+            data.push_back(' ');
+            data += needles[random() % needles.size()];
+        }
+        data.push_back('\n');
+    }
+    data.resize(spec.file_size);
+    return data;
+}
+
+void write_file(const std::filesystem::path& path, const std::string& data)
+{
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(data.data(), data.size());
+}
+
+// Генерация набора файлов. Если набор с теми же параметрами уже существует, он используется повторно.
+Corpus generate_corpus(const std::filesystem::path& root, const CorpusSpec& spec, uint64_t seed, size_t index)
+{
+    Corpus corpus;
+    corpus.name = spec.name;
+    corpus.path = root / spec.name;
+
+    std::ostringstream signature;
+    signature << seed << ' ' << spec.directories << ' ' << spec.depth << ' ' << spec.files << ' '
+              << spec.file_size << ' ' << spec.density << ' ' << spec.binary;
+    const std::filesystem::path manifest = root / (spec.name + ".manifest");
+    {
+        std::ifstream stream(manifest);
+        std::string line;
+        if (std::getline(stream, line) && line == signature.str() && stream >> corpus.files >> corpus.bytes)
+        { return corpus; }
+    }
+
+    std::filesystem::remove_all(corpus.path);
+    std::mt19937_64 random(seed * 1000003 + index);
+    for (size_t directory = 0; directory < spec.directories; ++directory)
+    {
+        std::filesystem::path path = corpus.path / ("d" + std::to_string(directory));
+        for (size_t level = 0; level < spec.depth; ++level)
+        {
+            std::filesystem::create_directories(path);
+            for (size_t file = 0; file < spec.files; ++file)
+            {
+                std::string data = generate_file(random, spec);
+                write_file(path / ("f" + std::to_string(file) + (spec.binary ? ".bin" : ".txt")), data);
+                ++corpus.files;
+                corpus.bytes += data.size();
+            }
+            path /= "l" + std::to_string(level);
+        }
+    }
+
+    std::ofstream stream(manifest);
+    stream << signature.str() << '\n' << corpus.files << ' ' << corpus.bytes << '\n';
+    return corpus;
+}
+
+// Создание объекта поиска по названию алгоритма.
+std::shared_ptr<Searcher> make_searcher(const std::string& engine)
+{
+    if (engine == "kmp") { return std::make_shared<KMP>(needle); }
+    if (engine == "simd") { return std::make_shared<SIMD>(needle); }
+    if (engine == "horspool") { return std::make_shared<Horspool>(needle); }
+    if (engine == "twoway") { return std::make_shared<TwoWay>(needle); }
+    if (engine == "aho-corasick") { return std::make_shared<AhoCorasick>(needles); }
+    return std::make_shared<Regex>(expression);
+}
+
+// Время (в секундах) одного поиска в наборе corpus. Вывод направляется в /dev/null.
+double run(const Corpus& corpus, const std::string& engine, const std::string& mode, size_t threads_number)
+{
+    const int null_descriptor = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    std::shared_ptr<Searcher> searcher = make_searcher(engine);
+
+    Walker::Options options;
+    if (mode == "whole-files") { options.chunk_size = 0; }
+
+    auto started = std::chrono::steady_clock::now();
+    {
+        std::shared_ptr<Output> output = std::make_shared<Output>(null_descriptor, mode == "sorted");
+        Walker walker(searcher, output, threads_number, options);
+        walker.walk(corpus.path, true);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threads_number; ++i)
+        { threads.push_back(std::thread(&Walker::search, std::ref(walker), i)); }
+        for (auto& thread : threads) { thread.join(); }
+        output->finish();
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    close(null_descriptor);
+    return elapsed;
+}
+
+std::vector<size_t> parse_list(const std::string& text)
+{
+    std::vector<size_t> values;
+    std::istringstream stream(text);
+    for (std::string item; std::getline(stream, item, ',');) { values.push_back(std::stoull(item)); }
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "psearch_bench";
+    uint64_t seed = 1;
+    double scale = 1.0;
+    size_t repeat = 3;
+    std::vector<size_t> threads_numbers;
+    for (size_t threads = 1; threads <= std::max<size_t>(std::thread::hardware_concurrency(), 1); threads *= 2)
+    { threads_numbers.push_back(threads); }
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string key = argv[i];
+        const std::string value = argv[i + 1];
+        if (key == "--corpus") { root = value; }
+        else if (key == "--seed") { seed = std::stoull(value); }
+        else if (key == "--scale") { scale = std::stod(value); }
+        else if (key == "--threads") { threads_numbers = parse_list(value); }
+        else if (key == "--repeat") { repeat = std::max<size_t>(std::stoull(value), 1); }
+        else
+        {
+            std::cerr << "Неизвестный аргумент: " << key << std::endl;
+            return 1;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        std::cerr << "Отсутствует значение аргумента: " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+
+    // Наборы файлов: много мелких файлов, несколько огромных, глубокое дерево, высокая и низкая
+    // плотность вхождений, случайные байты. Параметр scale пропорционально меняет число файлов.
+    auto scaled = [scale](size_t value) { return std::max<size_t>(static_cast<size_t>(value * scale), 1); };
+    const std::vector<CorpusSpec> specs =
+    {
+        {"tiny",   scaled(200), 1,  100,        512,               0.02,  false},
+        {"huge",   1,           1,  scaled(4),  32 * 1024 * 1024,  0.001, false},
+        {"deep",   scaled(64),  32, 2,          2048,              0.02,  false},
+        {"dense",  1,           1,  scaled(64), 1024 * 1024,       0.9,   false},
+        {"sparse", 1,           1,  scaled(64), 1024 * 1024,       1e-5,  false},
+        {"binary", 1,           1,  scaled(32), 2 * 1024 * 1024,   1e-3,  true},
+    };
+    const std::vector<std::string> engines = {"kmp", "simd", "horspool", "twoway", "aho-corasick", "regex"};
+    const std::vector<std::string> modes = {"default", "whole-files", "sorted"};
+
+    std::filesystem::create_directories(root);
+    for (size_t index = 0; index < specs.size(); ++index)
+    {
+        const Corpus corpus = generate_corpus(root, specs[index], seed, index);
+        for (const std::string& engine : engines)
+        {
+            for (const std::string& mode : modes)
+            {
+                run(corpus, engine, mode, 1); // Прогрев кэша страниц.
+                double single = 0;
+                for (size_t threads_number : threads_numbers)
+                {
+                    // Медиана из repeat измерений.
+                    std::vector<double> times;
+                    for (size_t i = 0; i < repeat; ++i) { times.push_back(run(corpus, engine, mode, threads_number)); }
+                    std::sort(times.begin(), times.end());
+                    const double elapsed = times[times.size() / 2];
+                    if (threads_number == 1) { single = elapsed; }
+
+                    std::cout << std::fixed << std::setprecision(4)
+                              << "{\"corpus\": \"" << corpus.name << "\", \"engine\": \"" << engine
+                              << "\", \"mode\": \"" << mode << "\", \"threads\": " << threads_number
+                              << ", \"seed\": " << seed << ", \"files\": " << corpus.files << ", \"bytes\": " << corpus.bytes
+                              << ", \"wall_s\": " << elapsed
+                              << ", \"gb_per_s\": " << corpus.bytes / elapsed / 1e9
+                              << ", \"files_per_s\": " << corpus.files / elapsed
+                              << ", \"speedup\": " << (single > 0 ? single / elapsed : 0.0)
+                              << "}" << std::defaultfloat << std::endl;
+                }
+            }
+        }
+    }
+    return 0;
+}
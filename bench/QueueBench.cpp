@@ -0,0 +1,120 @@
+#include <cinttypes>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "MPMCQueue.hpp"
+
+// Измерение пропускной способности очереди файлов Walker при конкурентном доступе.
+// Половина потоков добавляет элементы, половина - извлекает; сравниваются MPMCQueue и
+// std::queue под std::mutex (прежняя реализация очереди файлов). Строки, в которых потоков больше,
+// чем аппаратных потоков машины, помечаются: они измеряют переключение контекста, а не масштабирование,
+// и выводы о масштабировании (например, за 32 потока) делаются только по непомеченным строкам.
+
+// Элемент очереди того же размера, что и задача Walker (путь и размер файла).
+struct Item
+{
+    std::string path;
+    uintmax_t size = 0;
+};
+
+// Очередь под mutex с тем же интерфейсом, что и MPMCQueue.
+class LockedQueue
+{
+public:
+    explicit LockedQueue(size_t init_capacity) : capacity(init_capacity) {}
+
+    bool try_push(Item& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.size() >= capacity) { return false; }
+        queue.push(std::move(value));
+        return true;
+    }
+
+    bool try_pop(Item& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.empty()) { return false; }
+        value = std::move(queue.front());
+        queue.pop();
+        return true;
+    }
+
+protected:
+    std::mutex mutex;
+    std::queue<Item> queue;
+    size_t capacity;
+};
+
+// Время (в секундах) передачи items элементов от producers потоков-производителей consumers потокам-потребителям.
+template <typename Queue>
+double run(size_t producers, size_t consumers, size_t items)
+{
+    Queue queue(4096);
+    std::atomic<size_t> consumed = 0;
+    std::atomic<bool> start = false;
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]()
+        {
+            while (!start.load()) { std::this_thread::yield(); }
+            const size_t count = items / producers + (p < items % producers);
+            for (size_t i = 0; i < count; ++i)
+            {
+                Item item{"/some/directory/file.txt", i};
+                while (!queue.try_push(item)) { std::this_thread::yield(); }
+            }
+        });
+    }
+    for (size_t c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&]()
+        {
+            while (!start.load()) { std::this_thread::yield(); }
+            Item item;
+            while (consumed.load(std::memory_order_relaxed) < items)
+            {
+                if (queue.try_pop(item)) { consumed.fetch_add(1, std::memory_order_relaxed); }
+                else { std::this_thread::yield(); }
+            }
+        });
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    start.store(true);
+    for (auto& thread : threads) { thread.join(); }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+int main(int argc, char* argv[])
+{
+    size_t items = 2000000;
+    size_t max_threads = 64;
+    if (argc > 1) { items = std::stoull(argv[1]); }
+    if (argc > 2) { max_threads = std::stoull(argv[2]); }
+
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    std::cout << "# hardware_threads " << hardware_threads << std::endl;
+    std::cout << "threads\tmpmc_mops\tmutex_mops\toversubscribed" << std::endl;
+    for (size_t threads = 2; threads <= max_threads; threads *= 2)
+    {
+        const size_t producers = threads / 2;
+        const size_t consumers = threads - producers;
+        const double mpmc = run<MPMCQueue<Item>>(producers, consumers, items);
+        const double locked = run<LockedQueue>(producers, consumers, items);
+        std::cout << threads << std::fixed << std::setprecision(2)
+                  << "\t" << items / mpmc / 1e6
+                  << "\t" << items / locked / 1e6 << std::defaultfloat
+                  << "\t" << (threads > hardware_threads ? "yes" : "no") << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef PSEARCH_AHOCORASICK
+#define PSEARCH_AHOCORASICK
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Searcher.hpp"
+
+////////////////   AhoCorasick   ///////////////
+// Класс, реализующий автомат Ахо-Корасик для одновременного поиска нескольких образцов за один проход.
+// Переходы из корня хранятся в плотной таблице, переходы из остальных состояний - в общем массиве
+// отсортированных рёбер. Состояния пронумерованы в порядке обхода в ширину, поэтому часто используемые
+// неглубокие состояния расположены в памяти рядом. При поиске без учёта регистра бор строится по
+// образцам в нижнем регистре, а для букв ASCII добавляются рёбра по заглавным буквам; символы вне ASCII
+// перебираются по вариантам регистра, каждый вариант сообщается как исходный образец.
+class AhoCorasick : public Searcher
+{
+public:
+    AhoCorasick(const std::vector<std::string>& init_patterns, bool init_case_insensitive = false);
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t id) const { return patterns[id]; }
+    bool crosses_lines() const;
+    std::vector<std::string> required_literals() const { return case_insensitive ? std::vector<std::string>() : patterns; }
+
+protected:
+    // Состояние автомата.
+    struct State
+    {
+        uint32_t fail;          // Суффиксная ссылка.
+        uint32_t edges_begin;   // Начало рёбер состояния в edge_bytes и edge_targets.
+        uint32_t edges_count;   // Число рёбер состояния.
+        uint32_t outputs_begin; // Начало номеров образцов, оканчивающихся в состоянии, в outputs.
+        uint32_t outputs_count; // Число образцов, оканчивающихся в состоянии (с учётом суффиксных ссылок).
+    };
+
+    std::vector<std::string> patterns;     // Строки-образцы.
+    bool case_insensitive;                 // Поиск без учёта регистра.
+    uint32_t root_table[256];              // Плотная таблица переходов из корня.
+    std::vector<State> states;             // Состояния автомата.
+    std::vector<unsigned char> edge_bytes; // Символы рёбер.
+    std::vector<uint32_t> edge_targets;    // Состояния, в которые ведут рёбра.
+    std::vector<uint32_t> outputs;         // Номера образцов для всех состояний.
+
+    uint32_t next(uint32_t state, unsigned char byte) const;
+
+    static const size_t max_variants = 4096; // Максимальное число вариантов регистра одного образца.
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PSEARCH_CASEFOLD
+#define PSEARCH_CASEFOLD
+#include <string>
+#include <vector>
+#include <cstdint>
+
+////////////////    CaseFold    ////////////////
+// Простое (символ в символ) сопоставление регистров для поиска без учёта регистра. Учитываются
+// латиница ASCII и расширенная латиница, греческий, кириллица и армянский. Буквы ASCII сопоставляются
+// только буквам ASCII.
+class CaseFold
+{
+public:
+    CaseFold() = delete;
+
+    // Байт в нижнем регистре (для букв ASCII).
+    static unsigned char fold_ascii(unsigned char byte) { return (byte >= 'A' && byte <= 'Z') ? byte + ('a' - 'A') : byte; }
+    // Является ли байт буквой ASCII.
+    static bool is_ascii_letter(unsigned char byte) { return fold_ascii(byte) >= 'a' && fold_ascii(byte) <= 'z'; }
+
+    // Кодовая точка в нижнем регистре.
+    static uint32_t fold(uint32_t codepoint);
+    // Все кодовые точки, совпадающие с codepoint без учёта регистра (включая её саму).
+    static std::vector<uint32_t> variants(uint32_t codepoint);
+    // Есть ли в строке UTF-8 символы вне ASCII, имеющие варианты в другом регистре.
+    static bool has_unicode_cases(const std::string& text);
+    // Все варианты написания строки UTF-8: буквы ASCII приводятся к нижнему регистру, остальные символы
+    // перебираются по вариантам регистра. Если вариантов больше limit, выбрасывается std::length_error.
+    static std::vector<std::string> expand(const std::string& text, size_t limit);
+
+    static constexpr uint32_t max_cased = 0x1EFF; // Наибольшая кодовая точка, имеющая варианты регистра.
+
+protected:
+
+private:
+
+};
+
+#endif
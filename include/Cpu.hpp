@@ -0,0 +1,33 @@
+#ifndef PSEARCH_CPU
+#define PSEARCH_CPU
+#include <string>
+#include <vector>
+#include <cstddef>
+
+////////////////      Cpu       ////////////////
+// Сведения о ядрах, доступных процессу: число одновременно выполняемых потоков с учётом маски привязки
+// и квоты cgroup, порядок логических ядер для привязки рабочих потоков.
+class Cpu
+{
+public:
+    Cpu() = delete;
+
+    // Число потоков, которые процесс может выполнять одновременно: наименьшее из hardware_concurrency,
+    // числа ядер в маске привязки и квоты процессорного времени cgroup (v1 или v2, с округлением вверх).
+    static size_t available();
+    // Логические ядра из маски привязки: сначала по одному на каждое физическое ядро, затем остальные
+    // (соседи по hyperthreading), поэтому первые потоки не делят физических ядер.
+    static std::vector<int> cores();
+    // Привязка вызывающего потока к ядру cores[index % cores.size()]. Возвращает false при ошибке.
+    static bool pin(const std::vector<int>& cores, size_t index);
+
+protected:
+    static size_t cgroup_limit();
+    static bool read_text(const std::string& path, std::string& text);
+    static long read_number(const std::string& path);
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef PSEARCH_DECOMPRESSOR
+#define PSEARCH_DECOMPRESSOR
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+////////////////   BlockPool    ////////////////
+// Общий для всех рабочих потоков пул блоков фиксированного размера для распакованных данных. Число
+// блоков ограничено, поэтому память не растёт с числом потоков: распаковка ждёт освобождения блока.
+class BlockPool
+{
+public:
+    // Блок распакованных данных.
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size = 0; // Число заполненных байт.
+    };
+
+    BlockPool(size_t init_block_size, size_t init_blocks_number);
+
+    BlockPool(BlockPool&& other) = delete;
+    BlockPool(const BlockPool& other) = delete;
+    BlockPool& operator =(BlockPool&& other) = delete;
+    BlockPool& operator =(const BlockPool& other) = delete;
+
+    // Получение свободного блока (с ожиданием, если все блоки заняты). Блоки выделяются по мере надобности.
+    Block* acquire();
+    // Возврат блока в пул.
+    void release(Block* block);
+
+    size_t get_block_size() const { return block_size; }
+
+protected:
+    size_t block_size;                          // Размер блока.
+    size_t blocks_number;                       // Наибольшее число блоков.
+    std::vector<std::unique_ptr<Block>> blocks; // Выделенные блоки.
+    std::vector<Block*> free_blocks;            // Свободные блоки.
+    std::mutex mutex_blocks;                    // mutex для блоков.
+    std::condition_variable condition_blocks;   // Переменная состояния для ожидания свободного блока.
+
+private:
+
+};
+
+////////////////  Decompressor  ////////////////
+// Потоковая распаковка сжатых файлов (gzip через zlib, zstd через libzstd, если они доступны при сборке)
+// в блоки из общего пула. Распаковка выполняется в отдельном потоке и опережает поиск не больше чем
+// на max_ready блоков: пока рабочий поток ищет в одном блоке, следующий уже распаковывается.
+// У каждого рабочего потока свой Decompressor; одновременно распаковывается один файл.
+class Decompressor
+{
+public:
+    enum class Format
+    {
+        none, // Несжатые данные (или формат, поддержка которого не собрана).
+        gzip,
+        zstd,
+    };
+
+    Decompressor(std::shared_ptr<BlockPool> init_pool);
+    ~Decompressor();
+
+    Decompressor(Decompressor&& other) = delete;
+    Decompressor(const Decompressor& other) = delete;
+    Decompressor& operator =(Decompressor&& other) = delete;
+    Decompressor& operator =(const Decompressor& other) = delete;
+
+    // Запуск распаковки сжатых данных [begin, end). Данные должны оставаться доступными до вызова finish.
+    void start(Format format, const char* begin, const char* end);
+    // Следующий распакованный блок (с ожиданием); nullptr, если данные кончились.
+    BlockPool::Block* next();
+    // Возврат прочитанного блока в пул.
+    void release(BlockPool::Block* block) { pool->release(block); }
+    // Завершение распаковки (в том числе досрочное, если поиск прекращён). Возвращает false, если
+    // данные повреждены или обрезаны.
+    bool finish();
+
+    // Формат сжатия по сигнатуре в начале данных.
+    static Format detect(const char* data, size_t size);
+
+protected:
+    std::shared_ptr<BlockPool> pool;           // Пул блоков.
+    std::thread thread;                        // Поток распаковки.
+    std::mutex mutex_state;                    // mutex для состояния распаковки.
+    std::condition_variable condition_state;   // Переменная состояния для ожидания блоков и заданий.
+    std::deque<BlockPool::Block*> ready;       // Распакованные блоки, ожидающие поиска.
+    Format format = Format::none;              // Формат текущего файла.
+    const char* input_begin = nullptr;         // Сжатые данные текущего файла.
+    const char* input_end = nullptr;
+    bool pending = false;                      // Ожидает ли файл начала распаковки.
+    bool producing = false;                    // Распаковывается ли файл.
+    bool cancelled = false;                    // Прекращена ли распаковка досрочно.
+    bool failed = false;                       // Повреждены ли данные.
+    bool stopping = false;                     // Завершается ли поток распаковки.
+
+    static const size_t max_ready = 2; // Наибольшее число распакованных блоков, ожидающих поиска.
+
+    void work();
+    bool push(BlockPool::Block* block);
+    bool inflate_gzip();
+    bool decompress_zstd();
+
+private:
+
+};
+
+#endif
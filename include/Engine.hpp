@@ -0,0 +1,69 @@
+#ifndef PSEARCH_ENGINE
+#define PSEARCH_ENGINE
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Searcher.hpp"
+
+////////////////     Engine     ////////////////
+// Выбор и создание объекта поиска по параметрам запроса. Для набора образцов используется автомат
+// Ахо-Корасик, для регулярного выражения - ленивый ДКА; для одного образца алгоритм задаётся явно
+// или выбирается автоматически по длине образца и частотам его байтов.
+class Engine
+{
+public:
+    // Параметры запроса.
+    struct Query
+    {
+        std::string pattern;               // Образец или регулярное выражение.
+        std::vector<std::string> patterns; // Набор образцов (вместо pattern).
+        std::string engine;                // Алгоритм поиска одного образца (пустая строка или auto - автоматический выбор).
+        bool regex = false;                // pattern - регулярное выражение.
+        bool case_insensitive = false;     // Поиск без учёта регистра.
+    };
+
+    Engine() = delete;
+
+    // Название алгоритма, который будет использован для запроса.
+    static std::string choose(const Query& query);
+    // Создание объекта поиска. Ошибки в запросе сообщаются исключениями std::invalid_argument и std::length_error,
+    // в том числе явно заданный алгоритм, который не может выполнить запрос (-i с символами вне ASCII).
+    static std::shared_ptr<Searcher> create(const Query& query);
+    // Допустимые значения Query::engine.
+    static const std::vector<std::string>& single_pattern_engines();
+
+protected:
+    static std::shared_ptr<Searcher> create(const Query& query, const std::string& name);
+
+private:
+
+};
+
+////////////////   Crosscheck   ////////////////
+// Объект поиска для самопроверки: поиск выполняется двумя алгоритмами, результаты сравниваются.
+// При расхождении описание выводится в stderr и программа аварийно завершается.
+class Crosscheck : public Searcher
+{
+public:
+    Crosscheck(std::shared_ptr<Searcher> init_primary, std::shared_ptr<Searcher> init_secondary,
+               const std::string& init_primary_name, const std::string& init_secondary_name);
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    void set_limits(const Limits& init_limits);
+    const std::string& get_pattern(uint32_t id) const { return primary->get_pattern(id); }
+    bool crosses_lines() const { return primary->crosses_lines() || secondary->crosses_lines(); }
+    std::vector<std::string> required_literals() const { return primary->required_literals(); }
+
+protected:
+    std::shared_ptr<Searcher> primary;   // Основной алгоритм (его результат используется для вывода).
+    std::shared_ptr<Searcher> secondary; // Проверочный алгоритм.
+    std::string primary_name;
+    std::string secondary_name;
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PSEARCH_FILEVIEW
+#define PSEARCH_FILEVIEW
+#include <filesystem>
+#include <vector>
+
+////////////////    FileView    ////////////////
+// Класс для доступа к содержимому файла как к непрерывному диапазону байт.
+// Обычные файлы отображаются в память, остальные (каналы, специальные файлы) считываются в буффер.
+class FileView
+{
+public:
+    FileView(const std::filesystem::path& path);
+    ~FileView();
+
+    FileView(FileView&& other) = delete;
+    FileView(const FileView& other) = delete;
+    FileView& operator =(FileView&& other) = delete;
+    FileView& operator =(const FileView& other) = delete;
+
+    bool is_open() const { return opened; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + data_size; }
+    size_t size() const { return data_size; }
+
+protected:
+    bool opened = false;        // Удалось ли открыть файл.
+    bool mapped = false;        // Отображён ли файл в память.
+    const char* data = nullptr; // Начало содержимого.
+    size_t data_size = 0;       // Размер содержимого.
+    std::vector<char> buffer;   // Буффер для файлов, которые нельзя отобразить в память.
+
+    static const size_t read_block_size = 64 * 1024; // Размер блока при чтении в буффер.
+
+    void read_all(int descriptor);
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef PSEARCH_FILTER
+#define PSEARCH_FILTER
+#include <string>
+#include <filesystem>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+////////////////     Filter     ////////////////
+// Фильтр путей, применяемый при обходе директорий: скрытые файлы, шаблоны --glob, правила файлов
+// .gitignore и .ignore и ограничение размера. Директории отсекаются до обхода, поэтому исключённые
+// поддеревья не читаются вовсе. Кроме того, фильтр определяет двоичные файлы по первому блоку.
+class Filter
+{
+public:
+    // Параметры фильтра.
+    struct Options
+    {
+        std::vector<std::string> globs; // Шаблоны отбора файлов; шаблоны с префиксом '!' исключают файлы и директории.
+        bool ignore_files = true;       // Учитывать ли .gitignore и .ignore.
+        bool hidden = false;            // Обходить ли скрытые файлы и директории (имя начинается с точки).
+        bool follow_links = false;      // Обходить ли директории по символическим ссылкам.
+        bool binary = false;            // Искать ли в двоичных файлах.
+        uintmax_t max_size = 0;         // Файлы большего размера пропускаются (0 - без ограничения).
+    };
+
+    // Скомпилированный шаблон в синтаксисе .gitignore: '*' и '?' (не совпадают с '/'), классы [...],
+    // '**' (любое число директорий). Шаблон без '/' сравнивается с именем, остальные - с путём
+    // относительно директории, в которой задан шаблон. Для частых видов шаблонов (имя целиком,
+    // '*.ext') сравнение выполняется без разбора шаблона.
+    class Glob
+    {
+    public:
+        Glob(const std::string& text);
+
+        // Совпадает ли шаблон с записью: path - путь относительно директории шаблона, name - имя.
+        bool matches(const char* path, size_t path_size, const char* name, size_t name_size, bool directory) const;
+        bool is_negated() const { return negated; }
+        bool is_anchored() const { return anchored; }
+
+    protected:
+        enum class Kind
+        {
+            literal, // Шаблон без специальных символов.
+            suffix,  // '*' и окончание без специальных символов.
+            general, // Остальные шаблоны.
+        };
+
+        std::string pattern;         // Шаблон без '!', начального и конечного '/'.
+        Kind kind;                   // Вид шаблона.
+        bool negated = false;        // Шаблон начинается с '!'.
+        bool directory_only = false; // Шаблон заканчивается на '/' и совпадает только с директориями.
+        bool anchored = false;       // Шаблон содержит '/' и сравнивается с путём.
+
+        static bool match(const char* pattern, const char* pattern_end, const char* text, const char* text_end);
+        static bool match_class(const char*& pattern, const char* pattern_end, char ch);
+
+    private:
+
+    };
+
+    // Правила файлов .gitignore и .ignore одной директории. Директории без таких файлов используют
+    // правила ближайшей родительской директории, поэтому цепочка содержит только директории с правилами.
+    struct Ignore
+    {
+        std::shared_ptr<const Ignore> parent; // Правила родительских директорий.
+        size_t base_size;                     // Длина пути директории правил вместе с разделителем.
+        size_t root_size;                     // Длина пути начальной директории обхода вместе с разделителем.
+        std::vector<Glob> globs;              // Правила в порядке возрастания приоритета.
+        std::string prefix;                   // Для директорий выше начальной - путь начальной директории
+                                              // относительно директории правил (с разделителем).
+    };
+
+    Filter(const Options& init_options);
+
+    // Правила директорий выше начальной директории обхода directory, вплоть до корня репозитория git
+    // (директории, содержащей .git). Собственные файлы правил начальной директории читает enter.
+    std::shared_ptr<const Ignore> root(const std::string& directory) const;
+    // Правила директории directory (открытой как descriptor) с учётом правил родительских директорий.
+    std::shared_ptr<const Ignore> enter(const std::string& directory, int descriptor, const std::shared_ptr<const Ignore>& parent) const;
+    // Допускается ли запись name с полным путём path в директории с правилами ignore.
+    bool allows(const std::string& path, const char* name, bool directory, const Ignore& ignore) const;
+    // Допускается ли файл размера size.
+    bool fits(uintmax_t size) const { return !options.max_size || size <= options.max_size; }
+    // Пропускается ли файл, начинающийся с диапазона [begin, begin + size).
+    bool skips(const char* begin, size_t size) const { return !options.binary && is_binary(begin, size); }
+
+    const Options& get_options() const { return options; }
+
+    // Является ли файл двоичным: в первом блоке есть нулевой байт.
+    static bool is_binary(const char* begin, size_t size);
+
+    static const size_t binary_probe = 8192; // Размер начала файла, проверяемого на нулевые байты.
+
+protected:
+    Options options;            // Параметры фильтра.
+    std::vector<Glob> includes; // Шаблоны отбора файлов.
+    std::vector<Glob> excludes; // Шаблоны исключения.
+
+    static void load(int descriptor, const char* name, std::vector<Glob>& globs);
+
+private:
+
+};
+
+#endif
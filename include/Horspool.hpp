@@ -0,0 +1,39 @@
+#ifndef PSEARCH_HORSPOOL
+#define PSEARCH_HORSPOOL
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "Searcher.hpp"
+
+////////////////    Horspool    ////////////////
+// Класс, реализующий алгоритм Бойера-Мура-Хорспула: окно образца сдвигается по таблице сдвигов
+// для последнего байта окна, поэтому для длинных образцов просматривается лишь часть байтов текста.
+// Совпадения не пропускаются (в том числе перекрывающиеся). При поиске без учёта регистра заглавные
+// буквы ASCII получают сдвиги строчных.
+class Horspool : public Searcher
+{
+public:
+    Horspool(const std::string& init_string, bool init_case_insensitive = false);
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t) const { return pattern; }
+    bool crosses_lines() const { return pattern.find('\n') != std::string::npos; }
+    std::vector<std::string> required_literals() const
+    { return case_insensitive ? std::vector<std::string>() : std::vector<std::string>{pattern}; }
+
+protected:
+    std::string pattern;                 // Строка-образец (без учёта регистра - в нижнем регистре).
+    bool case_insensitive;               // Поиск без учёта регистра букв ASCII.
+    std::array<uint32_t, 256> shifts;    // Сдвиг окна по последнему байту окна.
+
+    template <bool fold>
+    void search_loop(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+
+private:
+
+};
+
+#endif
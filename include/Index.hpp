@@ -0,0 +1,122 @@
+#ifndef PSEARCH_INDEX
+#define PSEARCH_INDEX
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+////////////////     Index      ////////////////
+// Триграммный индекс дерева файлов. Файл индекса содержит таблицы файлов (путь, размер, время
+// изменения) и директорий (путь, время изменения) и для каждой встречающейся триграммы - список номеров
+// файлов, в которых она есть. Списки хранятся как разности соседних номеров в кодировке varint. При
+// поиске индекс отображается в память, и полный поиск выполняется только в файлах, содержащих все
+// триграммы образца, а также в файлах, изменённых или добавленных после построения индекса. В индекс
+// входят файлы, которые обходит поиск с фильтром по умолчанию: без скрытых файлов и без файлов,
+// исключённых правилами .gitignore и .ignore.
+class Index
+{
+public:
+    Index() = default;
+    ~Index();
+
+    Index(Index&& other) = delete;
+    Index(const Index& other) = delete;
+    Index& operator =(Index&& other) = delete;
+    Index& operator =(const Index& other) = delete;
+
+    // Открытие файла индекса. Возвращает false, если файл отсутствует или повреждён.
+    bool open(const std::filesystem::path& index_path);
+    bool is_open() const { return data != nullptr; }
+
+    // Корневой путь, для которого построен индекс.
+    std::filesystem::path root() const;
+    // Число файлов в индексе.
+    size_t files_number() const;
+    // Лежит ли путь path внутри дерева индекса.
+    bool covers(const std::filesystem::path& path) const;
+
+    // Файлы, которые могут содержать хотя бы одну из подстрок literals. Подстроки короче трёх байт
+    // и пустой набор не ограничивают поиск. Файлы, не поддающиеся индексации, возвращаются всегда.
+    // Для каждого файла индекса проверяются размер и время изменения, для каждой директории - время
+    // изменения: изменённые файлы и новые файлы изменённых директорий возвращаются всегда, их число
+    // записывается в changed. Удалённые файлы не возвращаются. Возвращаются только файлы внутри path
+    // (пустой path - корень индекса) в той же форме, что и при обходе path: path/<путь относительно path>.
+    // Файлы и директории проверяются в threads_number потоков.
+    std::vector<std::filesystem::path> candidates(const std::vector<std::string>& literals, const std::filesystem::path& path,
+                                                  size_t threads_number, size_t& changed) const;
+
+    // Построение индекса для дерева root в файле index_path в threads_number потоков. Если по этому
+    // пути уже есть индекс, триграммы файлов с неизменными размером и временем изменения берутся из него.
+    // Возвращает число заново прочитанных файлов.
+    static size_t build(const std::filesystem::path& index_path, const std::filesystem::path& root, bool recursively, size_t threads_number);
+
+protected:
+    // Заголовок файла индекса.
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t root_length;          // Длина корневого пути.
+        uint64_t files_number;         // Число файлов.
+        uint64_t trigrams_number;      // Число различных триграмм.
+        uint64_t directories_number;   // Число директорий.
+        uint64_t files_offset;         // Смещение таблицы файлов.
+        uint64_t directories_offset;   // Смещение таблицы директорий.
+        uint64_t trigrams_offset;      // Смещение таблицы триграмм.
+        uint64_t postings_offset;      // Смещение списков номеров файлов.
+        uint64_t strings_offset;       // Смещение строк (корневого пути и путей файлов и директорий).
+        uint64_t total_size;           // Размер файла индекса.
+    };
+
+    // Запись таблицы файлов.
+    struct FileRecord
+    {
+        uint64_t path_offset;  // Смещение пути относительно начала строк.
+        uint32_t path_length;  // Длина пути.
+        uint32_t flags;        // Флаги (unindexed).
+        uint64_t size;         // Размер файла.
+        int64_t mtime;         // Время изменения в наносекундах.
+    };
+
+    // Запись таблицы директорий. Таблица упорядочена по путям, как и таблица файлов.
+    struct DirectoryRecord
+    {
+        uint64_t path_offset;  // Смещение пути относительно начала строк.
+        uint32_t path_length;  // Длина пути.
+        uint32_t flags;        // Флаги (traversed).
+        int64_t mtime;         // Время изменения в наносекундах.
+    };
+
+    // Запись таблицы триграмм. Таблица упорядочена по триграммам.
+    struct TrigramRecord
+    {
+        uint32_t trigram;         // Триграмма (три байта, первый - старший).
+        uint32_t postings_size;   // Размер списка в байтах.
+        uint64_t postings_offset; // Смещение списка относительно начала списков.
+    };
+
+    static const uint32_t unindexed = 1;         // Файл не индексирован (двоичный), подходит для любого запроса.
+    static const uint32_t traversed = 2;         // Поддиректории директории проиндексированы (рекурсивное построение).
+    static const uint32_t format_version = 3;    // Версия формата.
+    static const size_t check_part_size = 4096;  // Число файлов в части таблицы, проверяемой одним потоком.
+
+    const char* data = nullptr;     // Отображённый в память файл индекса.
+    size_t data_size = 0;           // Размер файла индекса.
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(data); }
+    const FileRecord* files() const { return reinterpret_cast<const FileRecord*>(data + header().files_offset); }
+    const DirectoryRecord* directories() const { return reinterpret_cast<const DirectoryRecord*>(data + header().directories_offset); }
+    const TrigramRecord* trigrams() const { return reinterpret_cast<const TrigramRecord*>(data + header().trigrams_offset); }
+    std::string_view string(uint64_t offset, uint32_t length) const { return std::string_view(data + header().strings_offset + offset, length); }
+    std::string file_path(uint32_t file) const;
+    bool has_file(std::string_view path) const;
+    bool has_directory(std::string_view path) const;
+    std::vector<uint32_t> postings(uint32_t trigram) const;
+    std::vector<uint32_t> literal_candidates(const std::string& literal) const;
+
+private:
+
+};
+
+#endif
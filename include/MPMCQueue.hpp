@@ -0,0 +1,104 @@
+#ifndef PSEARCH_MPMCQUEUE
+#define PSEARCH_MPMCQUEUE
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+////////////////    MPMCQueue   ////////////////
+// Ограниченная неблокирующая очередь для многих производителей и многих потребителей (алгоритм Вьюкова).
+// Каждая ячейка хранит счётчик последовательности, по которому поток определяет, свободна ли ячейка для
+// записи или готова для чтения; позиции записи и чтения захватываются через compare_exchange.
+template <typename T>
+class MPMCQueue
+{
+public:
+    // Ёмкость округляется вверх до степени двойки.
+    explicit MPMCQueue(size_t init_capacity)
+    {
+        size_t capacity = 2;
+        while (capacity < init_capacity) { capacity <<= 1; }
+        mask = capacity - 1;
+        cells.reset(new Cell[capacity]);
+        for (size_t i = 0; i < capacity; ++i) { cells[i].sequence.store(i, std::memory_order_relaxed); }
+    }
+
+    MPMCQueue(MPMCQueue&& other) = delete;
+    MPMCQueue(const MPMCQueue& other) = delete;
+    MPMCQueue& operator =(MPMCQueue&& other) = delete;
+    MPMCQueue& operator =(const MPMCQueue& other) = delete;
+
+    // Попытка добавления элемента. При успехе value перемещается в очередь, при переполнении - не изменяется.
+    bool try_push(T& value)
+    {
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells[position & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (difference < 0) { return false; } // Очередь заполнена.
+            else { position = enqueue_position.load(std::memory_order_relaxed); }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Попытка извлечения элемента. Возвращает false, если очередь пуста.
+    bool try_pop(T& value)
+    {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells[position & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (difference < 0) { return false; } // Очередь пуста.
+            else { position = dequeue_position.load(std::memory_order_relaxed); }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Приблизительное число элементов (точное в отсутствие одновременных операций).
+    size_t size() const
+    {
+        const size_t dequeued = dequeue_position.load();
+        const size_t enqueued = enqueue_position.load();
+        return (enqueued > dequeued) ? enqueued - dequeued : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask + 1; }
+
+protected:
+    // Ячейка очереди занимает отдельную линию кэша, чтобы соседние операции не мешали друг другу.
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;                        // Кольцевой буффер ячеек.
+    size_t mask;                                          // Маска для вычисления номера ячейки.
+    alignas(64) std::atomic<size_t> enqueue_position = 0; // Позиция следующей записи.
+    alignas(64) std::atomic<size_t> dequeue_position = 0; // Позиция следующего чтения.
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef PSEARCH_OUTPUT
+#define PSEARCH_OUTPUT
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <utility>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <atomic>
+
+#include "Searcher.hpp"
+
+////////////////     Output     ////////////////
+// Класс для вывода найденных вхождений. Потоки поиска форматируют строки в собственные буфферы (Arena)
+// без блокировок; заполненные буфферы передаются потоку записи, который выводит их крупными вызовами
+// write(2). В режиме сортировки вывод каждого файла собирается целиком и выводится в порядке обхода
+// (путей, упорядоченных по компонентам) после завершения поиска; до этого он хранится во временном файле,
+// а в памяти остаются только пути и смещения (если временный файл создать не удалось - весь вывод).
+// При встраивании в другие программы вместо дескриптора задаётся функция обратного вызова, получающая
+// вхождения каждого файла.
+class Output
+{
+public:
+    // Формат вывода.
+    enum class Mode
+    {
+        lines,  // Найденные строки с номерами.
+        files,  // Только пути файлов с вхождениями.
+        counts, // Пути файлов с вхождениями и число найденных строк.
+    };
+
+    // Получатель вхождений файла. Вызывается из потоков поиска параллельно; строки вхождений указывают
+    // в буфферы поиска и действительны только во время вызова. В режимах files и counts строки пусты.
+    using Callback = std::function<void(const std::filesystem::path& file, const std::vector<Searcher::Entry>& entries)>;
+
+    // Буффер вывода одного потока поиска.
+    class Arena
+    {
+    public:
+        Arena(Output& init_output);
+        ~Arena();
+
+        Arena(Arena&& other) = delete;
+        Arena(const Arena& other) = delete;
+        Arena& operator =(Arena&& other) = delete;
+        Arena& operator =(const Arena& other) = delete;
+
+        // Добавление вхождений файла file.
+        void add(const std::filesystem::path& file, const std::vector<Searcher::Entry>& entries, const Searcher& searcher);
+        // Добавление файла file с найденными строками entries (в режимах files и counts).
+        void add_file(const std::filesystem::path& file, const std::vector<Searcher::Entry>& entries);
+        // Завершение вывода файла file.
+        void end_file(const std::filesystem::path& file);
+        // Передача накопленного вывода потоку записи.
+        void flush();
+
+    protected:
+        Output& output;
+        std::string buffer;                               // Отформатированный вывод.
+        std::chrono::steady_clock::time_point last_flush; // Время последней передачи буффера.
+
+    private:
+
+    };
+
+    // Вывод в дескриптор. При выводе в канал или сокет вызывающая программа должна игнорировать SIGPIPE:
+    // после ошибки записи оставшийся вывод отбрасывается.
+    Output(int init_descriptor, bool init_sorted);
+    Output(int init_descriptor, bool init_sorted, Mode init_mode);
+    Output(Callback init_callback, Mode init_mode);
+    ~Output();
+
+    Output(Output&& other) = delete;
+    Output(const Output& other) = delete;
+    Output& operator =(Output&& other) = delete;
+    Output& operator =(const Output& other) = delete;
+
+    // Завершение вывода: запись оставшихся буфферов (в режиме сортировки - всех файлов по порядку).
+    // Вызывается после завершения всех потоков поиска.
+    void finish();
+
+    Mode get_mode() const { return mode; }
+    // Произошла ли ошибка записи в дескриптор (дальнейший вывод отбрасывается).
+    bool is_closed() const { return closed.load(std::memory_order_relaxed); }
+
+protected:
+    // Вывод файла в режиме сортировки: части во временном файле или текст в памяти.
+    struct Sorted
+    {
+        std::vector<std::pair<uint64_t, size_t>> ranges; // Смещения и размеры частей во временном файле.
+        std::string text;                                // Вывод без временного файла.
+    };
+
+    int descriptor = -1;                                // Файловый дескриптор для вывода.
+    Callback callback;                                  // Получатель вхождений (вместо дескриптора).
+    bool sorted = false;                                // Режим сортировки вывода.
+    Mode mode;                                          // Формат вывода.
+    std::mutex mutex_blocks;                            // mutex для работы с очередью буфферов.
+    std::condition_variable condition_blocks;           // Ожидание буфферов потоком записи.
+    std::condition_variable condition_space;            // Ожидание места в очереди потоками поиска.
+    std::deque<std::string> blocks;                     // Буфферы, ожидающие записи.
+    std::vector<std::string> free_buffers;              // Записанные буфферы для повторного использования.
+    std::map<std::filesystem::path, Sorted> files;      // Вывод файлов в режиме сортировки.
+    int spill = -1;                                     // Временный файл вывода в режиме сортировки.
+    uint64_t spill_size = 0;                            // Занятый размер временного файла.
+    std::atomic<bool> closed = false;                   // Произошла ли ошибка записи (вывод отбрасывается).
+    bool stopping = false;                              // Запрошено завершение потока записи.
+    std::thread writer;                                 // Поток записи.
+
+    static const size_t arena_size = 64 * 1024;                    // Размер буффера, после которого он передаётся на запись.
+    static const size_t max_blocks = 64;                           // Максимальное число буфферов в очереди.
+    static constexpr std::chrono::milliseconds flush_interval{50}; // Максимальная задержка вывода.
+
+    void submit(std::string& buffer);
+    void submit(const std::filesystem::path& file, std::string& buffer);
+    std::string take_buffer();
+    void write_all(const std::string& buffer);
+    void write_loop();
+
+private:
+
+};
+
+#endif
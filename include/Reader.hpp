@@ -0,0 +1,159 @@
+#ifndef PSEARCH_READER
+#define PSEARCH_READER
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+
+////////////////    ReadPool    ////////////////
+// Пул потоков блокирующего чтения для систем без io_uring. Потоки выполняют задания по порядку поступления.
+class ReadPool
+{
+public:
+    ReadPool(size_t threads_number);
+    ~ReadPool();
+
+    ReadPool(ReadPool&& other) = delete;
+    ReadPool(const ReadPool& other) = delete;
+    ReadPool& operator =(ReadPool&& other) = delete;
+    ReadPool& operator =(const ReadPool& other) = delete;
+
+    // Постановка задания в очередь.
+    void run(std::function<void()>&& job);
+
+protected:
+    std::vector<std::thread> threads;       // Потоки чтения.
+    std::deque<std::function<void()>> jobs; // Очередь заданий.
+    std::mutex mutex_jobs;                  // mutex для очереди заданий.
+    std::condition_variable condition_jobs; // Переменная состояния для ожидания заданий.
+    bool stopping = false;                  // Завершается ли работа пула.
+
+    void work();
+
+private:
+
+};
+
+////////////////     Reader     ////////////////
+// Асинхронное чтение файлов целиком в буфферы: пока поток ищет в одном файле, следующие файлы уже
+// читаются, и очередь диска не простаивает. Чтения выполняются через io_uring (системные вызовы
+// напрямую, без liburing) или, если ядро его не поддерживает, пулом потоков ReadPool после
+// posix_fadvise(WILLNEED), запускающего упреждающее чтение в ядре. Буфферы берутся из пула
+// ограниченного суммарного объёма, поэтому память не растёт с глубиной очереди.
+// У каждого рабочего потока свой Reader, поэтому кольца io_uring и пул буфферов не требуют синхронизации.
+class Reader
+{
+public:
+    enum class Backend
+    {
+        none,    // Асинхронное чтение не используется.
+        uring,   // io_uring.
+        threads, // Пул потоков чтения.
+    };
+
+    // Прочитанный файл.
+    struct Read
+    {
+        const char* data = nullptr;
+        size_t size = 0;
+        bool opened = false; // Удалось ли открыть файл.
+    };
+
+    Reader(Backend init_backend, std::shared_ptr<ReadPool> init_pool, size_t init_depth, size_t init_memory);
+    ~Reader();
+
+    Reader(Reader&& other) = delete;
+    Reader(const Reader& other) = delete;
+    Reader& operator =(Reader&& other) = delete;
+    Reader& operator =(const Reader& other) = delete;
+
+    // Постановка чтения файла path размера size с идентификатором tag. Возвращает false, если очередь
+    // заполнена или в пуле буфферов нет места; тогда файл следует прочитать синхронно.
+    bool submit(const char* path, size_t size, uint64_t tag);
+    // Передача поставленных чтений ядру.
+    void flush();
+    // Ожидание завершения чтения с идентификатором tag.
+    Read wait(uint64_t tag);
+    // Освобождение буффера прочитанного файла.
+    void release(uint64_t tag);
+
+    Backend get_backend() const { return backend; }
+
+    // Поддерживает ли ядро io_uring.
+    static bool uring_supported();
+
+protected:
+    // Буффер из пула.
+    struct Buffer
+    {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+    };
+
+    // Место в очереди чтения.
+    struct Slot
+    {
+        uint64_t tag = 0;         // Идентификатор запроса.
+        bool used = false;        // Занято ли место.
+        bool done = false;        // Завершено ли чтение.
+        int descriptor = -1;      // Дескриптор читаемого файла.
+        Buffer buffer;            // Буффер содержимого.
+        size_t size = 0;          // Запрошенный размер.
+        bool opened = false;      // Удалось ли открыть файл.
+        long result = 0;          // Число прочитанных байт или код ошибки со знаком минус.
+        struct iovec iovec = {};  // Описание буффера для IORING_OP_READV.
+    };
+
+    // Кольца io_uring, отображённые в память.
+    struct Ring
+    {
+        int descriptor = -1;
+        void* sq_memory = nullptr;
+        size_t sq_memory_size = 0;
+        void* cq_memory = nullptr;
+        size_t cq_memory_size = 0;
+        void* sqes_memory = nullptr;
+        size_t sqes_memory_size = 0;
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        void* cqes = nullptr;
+        unsigned unsubmitted = 0; // Подготовленные, но не переданные ядру запросы.
+    };
+
+    Backend backend;                         // Способ чтения.
+    std::shared_ptr<ReadPool> pool;          // Пул потоков чтения (для Backend::threads).
+    size_t memory;                           // Наибольший суммарный объём буфферов.
+    size_t allocated = 0;                    // Суммарный объём выделенных буфферов.
+    std::vector<Buffer> free_buffers;        // Свободные буфферы.
+    std::vector<Slot> slots;                 // Места в очереди чтения.
+    size_t in_flight = 0;                    // Число незавершённых чтений.
+    Ring ring;                               // Кольца io_uring (для Backend::uring).
+    bool failed = false;                     // Отказало ли кольцо (io_uring_enter завершился ошибкой).
+    std::mutex mutex_slots;                  // mutex для завершения чтений потоками пула.
+    std::condition_variable condition_slots; // Переменная состояния для ожидания завершения.
+
+    static const size_t buffer_granularity = 64 * 1024; // Размеры буфферов кратны buffer_granularity.
+
+    bool acquire(size_t size, Buffer& buffer);
+    bool setup_ring(unsigned entries);
+    void reap();
+    void abandon();
+    void complete(Slot& slot);
+    static long read_all(int descriptor, char* data, size_t size, size_t offset);
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef PSEARCH_REGEX
+#define PSEARCH_REGEX
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "Searcher.hpp"
+#include "SIMD.hpp"
+
+////////////////      Regex     ////////////////
+// Класс, реализующий поиск по регулярному выражению. Выражение компилируется в НКА (построение Томпсона),
+// состояния ДКА строятся лениво во время поиска и хранятся в ограниченном кэше. Каждый поток получает
+// собственный кэш из общего пула, поэтому один объект Regex может использоваться несколькими потоками.
+// Если все совпадения начинаются с общего литерального префикса, позиции-кандидаты находятся векторным
+// поиском этого префикса.
+//
+// Поддерживаемый синтаксис: литералы (UTF-8), ., [...], [^...], \d \D \w \W \s \S, \xHH, ^, $, (...),
+// (?:...), |, *, +, ?, {m}, {m,}, {m,n}. Совпадения не выходят за пределы строки. При поиске без учёта
+// регистра множества символов дополняются вариантами регистра (CaseFold) до построения НКА, поэтому
+// цикл поиска не меняется.
+class Regex : public Searcher
+{
+public:
+    Regex(const std::string& init_expression, bool init_case_insensitive = false);
+    ~Regex();
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t) const { return expression; }
+    std::vector<std::string> required_literals() const
+    { return (prefix.empty() || prefix_folded) ? std::vector<std::string>() : std::vector<std::string>{prefix}; }
+
+    // Экранирование строки для поиска её как литерала.
+    static std::string escape(const std::string& text);
+
+    // Литеральный префикс, с которого начинается любое совпадение (может быть пустым).
+    const std::string& get_prefix() const { return prefix; }
+
+protected:
+    // Состояние НКА.
+    struct NFAState
+    {
+        enum class Type : uint8_t
+        {
+            range,      // Переход по байту из диапазона [low, high].
+            split,      // Два пустых перехода: out и out_alternative.
+            epsilon,    // Пустой переход.
+            line_begin, // Пустой переход в начале строки (^).
+            line_end,   // Пустой переход в конце строки ($).
+            match,      // Допускающее состояние.
+        };
+
+        Type type;
+        unsigned char low = 0;
+        unsigned char high = 0;
+        uint32_t out = 0;
+        uint32_t out_alternative = 0;
+    };
+
+    struct Node;     // Узел синтаксического дерева выражения.
+    struct Fragment; // Фрагмент НКА с неприсоединёнными выходами.
+    class Parser;    // Синтаксический анализатор выражения.
+    class Cache;     // Кэш лениво построенных состояний ДКА.
+
+    std::string expression;            // Исходное регулярное выражение.
+    bool case_insensitive;             // Поиск без учёта регистра.
+    std::string prefix;                // Литеральный префикс всех совпадений.
+    bool prefix_folded = false;        // Префикс содержит буквы без учёта регистра (в нижнем регистре).
+    std::unique_ptr<SIMD> prefilter;   // Поиск префикса для пропуска участков без кандидатов.
+    std::vector<NFAState> nfa;         // Состояния НКА.
+    uint32_t nfa_start = 0;            // Начальное состояние НКА.
+    std::vector<uint32_t> line_start;  // Начальное множество состояний НКА в начале строки.
+    std::vector<uint32_t> inner_start; // Начальное множество состояний НКА внутри строки.
+    bool empty_match = false;          // Выражение допускает пустую строку в начале любой строки.
+    unsigned char class_map[256];      // Отображение байтов в классы эквивалентности.
+    size_t classes_number = 0;         // Число классов эквивалентности.
+    size_t max_states = 0;             // Максимальное число состояний ДКА в кэше.
+
+    mutable std::mutex mutex_caches;                    // mutex для работы с пулом кэшей.
+    mutable std::vector<std::unique_ptr<Cache>> caches; // Пул свободных кэшей ДКА.
+
+    static const size_t cache_capacity = 2 * 1024 * 1024; // Объём таблицы переходов кэша в байтах.
+
+    Fragment compile(const Node& node);
+    Fragment compile_characters(const Node& node);
+    uint32_t add_state(NFAState::Type type, unsigned char low = 0, unsigned char high = 0);
+    void patch(const Fragment& fragment, uint32_t target);
+    void build_classes();
+    static bool extract_prefix(const Node& node, std::string& prefix, bool& folded);
+
+    std::vector<uint32_t> closure(const std::vector<uint32_t>& seeds, bool at_line_begin, bool at_line_end) const;
+    bool matches_at_line_end(const std::vector<uint32_t>& set) const;
+
+    std::unique_ptr<Cache> acquire_cache() const;
+    void release_cache(std::unique_ptr<Cache> cache) const;
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PSEARCH_RESULTCACHE
+#define PSEARCH_RESULTCACHE
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "Searcher.hpp"
+
+////////////////  ResultCache   ////////////////
+// Постоянный кэш результатов поиска. Для каждого файла хранятся найденные строки (или пустой
+// результат), ключ - устройство и номер индексного дескриптора файла, проверка актуальности - по
+// времени изменения и размеру. Записи разных запросов различаются хэшем сигнатуры запроса (алгоритм,
+// образцы и параметры вывода). Записи, не использованные за max_age сохранений кэша подряд (удалённые
+// файлы, давние запросы), удаляются.
+// Кроме того, кэш отмечает файлы, уже взятые в обработку в текущем запуске: файл, доступный по
+// нескольким путям через жёсткие ссылки, обрабатывается (и выводится) один раз.
+class ResultCache
+{
+public:
+    // Идентификатор и отметка изменения файла.
+    struct Stamp
+    {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t mtime = 0;  // Время изменения в наносекундах.
+        uint64_t size = 0;
+    };
+
+    ResultCache(const std::filesystem::path& init_path, const std::string& signature);
+
+    ResultCache(ResultCache&& other) = delete;
+    ResultCache(const ResultCache& other) = delete;
+    ResultCache& operator =(ResultCache&& other) = delete;
+    ResultCache& operator =(const ResultCache& other) = delete;
+
+    // Отметка файла как взятого в обработку. Возвращает false, если файл уже был взят по другому пути.
+    bool claim(const Stamp& stamp);
+    // Есть ли актуальная запись для файла.
+    bool contains(const Stamp& stamp);
+    // Получение актуальной записи для файла. Возвращает false, если записи нет или она устарела.
+    bool lookup(const Stamp& stamp, std::vector<Searcher::Entry>& entries);
+    // Сохранение результата поиска в файле.
+    void store(const Stamp& stamp, const std::vector<Searcher::Entry>& entries);
+
+    // Запись кэша на диск: во временный файл в той же директории, который затем заменяет прежний.
+    // Возвращает false при ошибке записи.
+    bool save();
+
+protected:
+    // Ключ записи: устройство и номер индексного дескриптора.
+    struct Key
+    {
+        uint64_t device;
+        uint64_t inode;
+
+        bool operator ==(const Key& other) const { return device == other.device && inode == other.inode; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator ()(const Key& key) const { return key.inode * 0x9E3779B97F4A7C15ull ^ key.device; }
+    };
+
+    // Запись кэша.
+    struct Record
+    {
+        int64_t mtime;
+        uint64_t size;
+        uint32_t age;                 // Число сохранений кэша, при которых запись не использовалась.
+        bool used;                    // Использована ли запись в текущем запуске.
+        std::vector<Searcher::Entry> entries;
+        std::unique_ptr<char[]> text; // Строки записи, сохранённой в текущем запуске (строки загруженных
+                                      // записей указывают в contents).
+    };
+
+    std::filesystem::path path;                       // Файл кэша.
+    uint64_t signature_hash;                          // Хэш сигнатуры запроса.
+    std::mutex mutex_records;                         // mutex для записей и отметок.
+    std::unordered_map<Key, Record, KeyHash> records; // Записи текущего запроса.
+    std::unordered_set<Key, KeyHash> claimed;         // Файлы, взятые в обработку в текущем запуске.
+    std::string contents;                             // Содержимое файла кэша, прочитанное при создании.
+    std::string other_records;                        // Записи других запросов в исходном виде (с увеличенным возрастом).
+    bool modified = false;                            // Изменились ли записи.
+
+    static const uint32_t max_age = 16;               // Наибольший возраст сохраняемой записи.
+
+    void load();
+
+private:
+
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PSEARCH_SIMD
+#define PSEARCH_SIMD
+#include <string>
+#include <vector>
+
+#include "Searcher.hpp"
+
+////////////////      SIMD      ////////////////
+// Класс, реализующий поиск подстроки с векторной фильтрацией кандидатов: одновременно сравниваются
+// два наиболее редких байта образца, полная проверка выполняется только для совпавших позиций.
+// При поиске без учёта регистра у букв ASCII перед сравнением устанавливается бит 0x20, а полная
+// проверка сравнивает байты в нижнем регистре.
+class SIMD : public Searcher
+{
+public:
+    // Набор инструкций, используемый для фильтрации кандидатов.
+    enum class Kernel
+    {
+        scalar, // Без векторных инструкций.
+        sse2,   // 16 байт за итерацию.
+        avx2,   // 32 байта за итерацию.
+    };
+
+    SIMD(const std::string& init_string);
+    SIMD(const std::string& init_string, Kernel init_kernel, bool init_case_insensitive = false);
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t) const { return pattern; }
+    bool crosses_lines() const { return pattern.find('\n') != std::string::npos; }
+    std::vector<std::string> required_literals() const
+    { return case_insensitive ? std::vector<std::string>() : std::vector<std::string>{pattern}; }
+
+    // Поиск первого вхождения образца в диапазоне [begin, end). Если вхождений нет, возвращается end.
+    const char* find(const char* begin, const char* end) const;
+
+    // Наилучший набор инструкций, поддерживаемый процессором. Определяется один раз при запуске.
+    static Kernel best_kernel();
+
+protected:
+    std::string pattern;       // Строка-образец (без учёта регистра - в нижнем регистре).
+    bool case_insensitive;     // Поиск без учёта регистра букв ASCII.
+    size_t first_offset = 0;   // Позиция самого редкого байта образца.
+    size_t second_offset = 0;  // Позиция второго по редкости байта образца.
+    Kernel kernel;             // Используемый набор инструкций.
+
+    void choose_offsets();
+
+private:
+
+};
+
+#endif
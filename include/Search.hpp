@@ -0,0 +1,75 @@
+#ifndef PSEARCH_SEARCH
+#define PSEARCH_SEARCH
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "Searcher.hpp"
+#include "Engine.hpp"
+#include "Walker.hpp"
+#include "Output.hpp"
+
+////////////////     Search     ////////////////
+// Точка входа библиотеки libpsearch: поиск образца в директории или списке файлов без запуска
+// отдельного процесса. Объект выбирает и создаёт алгоритм поиска, обходит файлы в нескольких потоках
+// и передаёт вхождения каждого файла Output: в файловый дескриптор или функции обратного вызова,
+// получающей строки без копирования. Программа psearch - тонкий клиент этого класса.
+class Search
+{
+public:
+    // Параметры поиска.
+    struct Options
+    {
+        Engine::Query query;                     // Образцы и алгоритм поиска.
+        std::string check_engine;                // Алгоритм самопроверки (пустая строка - без самопроверки).
+        Output::Mode mode = Output::Mode::lines; // Формат результатов.
+        size_t max_lines = 0;                    // Поиск в файле прекращается после max_lines строк с вхождениями
+                                                 // (0 - без ограничения).
+        size_t threads_number = 1;               // Число потоков поиска. Подбор числа активных потоков
+                                                 // включается Walker::Options::adaptive (так запускается
+                                                 // psearch без -t, см. Cpu::available).
+        bool recursively = true;                 // Обходить ли поддиректории.
+        Walker::Options walker;                  // Параметры обхода, фильтрации и чтения файлов.
+    };
+
+    // Создание объекта поиска. Ошибки в запросе сообщаются исключениями std::invalid_argument и std::length_error.
+    Search(const Options& init_options);
+
+    Search(Search&& other) = delete;
+    Search(const Search& other) = delete;
+    Search& operator =(Search&& other) = delete;
+    Search& operator =(const Search& other) = delete;
+
+    // Поиск в директории или отдельном файле path. Режим output должен совпадать с Options::mode.
+    // Возвращает управление после завершения всех потоков поиска и вывода.
+    void run(const std::filesystem::path& path, std::shared_ptr<Output> output);
+    // Поиск в списке файлов без обхода директорий (например, отобранных по индексу).
+    void run(const std::vector<std::filesystem::path>& paths, std::shared_ptr<Output> output);
+    // Поиск в path с передачей вхождений каждого файла функции callback (см. Output::Callback).
+    void run(const std::filesystem::path& path, const Output::Callback& callback);
+    // Отмена поиска из любого потока. Выполняющийся run завершается после просмотра текущих файлов,
+    // последующие вызовы run возвращают управление сразу.
+    void cancel();
+
+    const Searcher& get_searcher() const { return *searcher; }
+    const std::string& get_engine_name() const { return engine_name; }
+
+protected:
+    Options options;                     // Параметры поиска.
+    std::shared_ptr<Searcher> searcher;  // Объект поиска.
+    std::string engine_name;             // Название выбранного алгоритма.
+    std::mutex mutex_walker;             // mutex для текущего обхода.
+    Walker* walker = nullptr;            // Текущий обход (nullptr - поиск не выполняется).
+    std::atomic<bool> cancelled = false; // Отменён ли поиск.
+
+    template <typename Target>
+    void run_walker(const Target& target, std::shared_ptr<Output> output);
+
+private:
+
+};
+
+#endif
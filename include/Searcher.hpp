@@ -1,41 +1,137 @@
 #ifndef PSEARCH_SEARCHER
 #define PSEARCH_SEARCHER
 #include <vector>
+#include <array>
+#include <variant>
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
 
 ////////////////    Searcher    ////////////////
 // Класс-интерфейс для всех объектов, предоставляющих функциональность поиска.
 class Searcher
 {
 public:
-    // Структура для хранения информации о найденных вхождениях образца.
+    // Структура для хранения информации о найденных вхождениях образца. Строка не копируется и указывает
+    // в просматриваемый диапазон, поэтому действительна, пока доступен его буффер.
     struct Entry
     {
         size_t line_number;
-        std::string line;
-        uint32_t entries_number;
+        std::string_view line;
+        uint32_t entries_number;        // Число вхождений в строке: позиций, в которых оканчивается вхождение
+                                        // (перекрывающиеся вхождения учитываются; при поиске нескольких
+                                        // образцов - для каждого образца).
+        std::vector<uint32_t> patterns; // Номера найденных в строке образцов (при поиске нескольких образцов).
     };
 
-    virtual void search(std::istream& stream, std::vector<Entry>& entries) const = 0;
+    // Ограничения поиска в одном диапазоне.
+    struct Limits
+    {
+        size_t max_lines = 0;   // Поиск прекращается после max_lines строк с вхождениями (0 - без ограничения).
+        bool copy_lines = true; // Определять ли границы и номера строк (не нужно, если выводятся только файлы или число строк).
+    };
+
+    virtual ~Searcher() = default;
+
+    // Поиск в диапазоне байт [begin, end). В entries добавляются только строки с вхождениями.
+    virtual void search(const char* begin, const char* end, std::vector<Entry>& entries) const = 0;
+
+    // Образец с номером id. Для поиска одного образца единственный допустимый номер - 0.
+    virtual const std::string& get_pattern(uint32_t id) const = 0;
+
+    // Может ли совпадение содержать перевод строки. Если нет, диапазон можно делить на части по границам строк.
+    virtual bool crosses_lines() const { return false; }
+
+    // Подстроки, хотя бы одна из которых содержится в любом диапазоне с вхождением (используются для
+    // отбора файлов по индексу). Пустой набор означает, что вхождение возможно в любом диапазоне.
+    virtual std::vector<std::string> required_literals() const { return {}; }
+
+    // Ограничения поиска. Задаются до начала поиска.
+    virtual void set_limits(const Limits& init_limits) { limits = init_limits; }
+    const Limits& get_limits() const { return limits; }
 
 protected:
+    // Класс для ленивого определения границ и номеров строк вокруг найденных вхождений.
+    class LineTracker
+    {
+    public:
+        LineTracker(const char* init_begin, const char* init_end, std::vector<Entry>& init_entries, const Limits& init_limits);
+
+        // Регистрация вхождения, последний символ которого находится по адресу position.
+        void add(const char* position)
+        {
+            if (position < line_end) { ++entries.back().entries_number; }
+            else { add_line(position); }
+        }
+
+        // Регистрация вхождения образца с номером pattern, последний символ которого находится по адресу position.
+        void add(const char* position, uint32_t pattern)
+        {
+            add(position);
+            std::vector<uint32_t>& patterns = entries.back().patterns;
+            if (std::find(patterns.begin(), patterns.end(), pattern) == patterns.end()) { patterns.push_back(pattern); }
+        }
+
+        // Достигнуто ли ограничение числа строк. Поиск в диапазоне после этого прекращается.
+        bool full() const { return lines_found == max_lines; }
+        // Конец последней найденной строки.
+        const char* last_line_end() const { return line_end; }
+
+    protected:
+        const char* begin;            // Начало диапазона поиска.
+        const char* end;              // Конец диапазона поиска.
+        const char* line_begin;       // Начало последней найденной строки.
+        const char* line_end;         // Конец последней найденной строки вместе с символом перевода строки.
+        size_t line_number = 0;       // Номер последней найденной строки.
+        size_t lines_found = 0;       // Число найденных строк.
+        size_t max_lines;             // Ограничение числа строк (SIZE_MAX - без ограничения).
+        bool copy_lines;              // Определять ли границы и номера строк.
+        std::vector<Entry>& entries;  // Вектор для сохранения вхождений.
+
+        void add_line(const char* position);
+    };
+
+    Limits limits; // Ограничения поиска.
 
 private:
 
 };
 
 ////////////////       KMP       ///////////////
-// Класс, реализующий автомат Кнута-Морриса-Пратта.
+// Класс, реализующий автомат Кнута-Морриса-Пратта. Байты разбиваются на классы эквивалентности
+// (по одному классу на каждый символ образца и общий класс для остальных байт), а номера состояний
+// хранятся в наименьшем подходящем беззнаковом типе, поэтому таблица помещается в кэш. При поиске
+// без учёта регистра заглавные буквы ASCII попадают в классы строчных, и цикл поиска не меняется.
 class KMP : public Searcher
 {
 public:
-    KMP(const std::string& init_string);
+    KMP(const std::string& init_string, bool init_case_insensitive = false);
 
-    void search(std::istream& stream, std::vector<Searcher::Entry>& entries) const;
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t) const { return pattern; }
+    bool crosses_lines() const { return pattern.find('\n') != std::string::npos; }
+    std::vector<std::string> required_literals() const
+    { return case_insensitive ? std::vector<std::string>() : std::vector<std::string>{pattern}; }
 
 protected:
-    std::string pattern;              // Строка-образец.
-    std::vector<size_t> states_table; // Таблица состояний.
+    // Таблица состояний с номерами состояний типа State.
+    template <typename State>
+    using Table = std::vector<State>;
+
+    std::string pattern;                                                         // Строка-образец (без учёта регистра - в нижнем регистре).
+    bool case_insensitive;                                                       // Поиск без учёта регистра букв ASCII.
+    std::array<uint8_t, 256> byte_classes;                                       // Класс эквивалентности каждого байта.
+    size_t classes_number;                                                       // Число классов эквивалентности.
+    size_t classes_shift;                                                        // Логарифм длины строки таблицы.
+    std::variant<Table<uint8_t>, Table<uint16_t>, Table<uint32_t>> states_table; // Таблица состояний.
+
+    template <typename State>
+    void build(const std::vector<size_t>& pi);
+    template <typename State>
+    void search_table(const Table<State>& table, const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
 
 private:
 
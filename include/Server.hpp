@@ -0,0 +1,113 @@
+#ifndef PSEARCH_SERVER
+#define PSEARCH_SERVER
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "Walker.hpp"
+
+////////////////     Server     ////////////////
+// Резидентный режим поиска. Сервер хранит в памяти список файлов дерева и обновляет его по событиям
+// inotify, а запросы принимает через Unix domain socket. Список файлов строится тем же фильтром обхода,
+// что и при поиске без сервера. Каждое соединение обслуживается своим потоком: медленный клиент не
+// задерживает приём других соединений. Поиск выполняет постоянный пул потоков, исполняющих
+// Walker::search, по одному запросу за раз; найденные вхождения передаются клиенту по мере нахождения,
+// пути выводятся относительно корня дерева.
+class Server
+{
+public:
+    // Запрос клиента.
+    struct Request
+    {
+        std::string pattern;               // Образец или регулярное выражение.
+        std::vector<std::string> patterns; // Набор образцов (вместо pattern).
+        std::string engine;                // Алгоритм поиска одного образца.
+        bool regex = false;                // pattern - регулярное выражение.
+        bool case_insensitive = false;     // Поиск без учёта регистра.
+        bool sorted = false;               // Упорядоченный вывод.
+        uintmax_t chunk_size = Walker::Options().chunk_size; // Размер частей больших файлов.
+        Output::Mode mode = Output::Mode::lines; // Формат вывода.
+        size_t max_lines = 0;              // Ограничение числа строк в файле.
+        size_t max_results = 0;            // Общее ограничение числа результатов.
+
+        std::string serialize() const;
+        bool parse(const std::string& message);
+    };
+
+    // Параметры поиска init_options (фильтр обхода, распаковка, способ чтения) применяются ко всем запросам;
+    // фильтр отбирает и файлы списка.
+    Server(const std::filesystem::path& init_root, bool init_recursively, size_t init_threads_number, const Walker::Options& init_options);
+    ~Server();
+
+    Server(Server&& other) = delete;
+    Server(const Server& other) = delete;
+    Server& operator =(Server&& other) = delete;
+    Server& operator =(const Server& other) = delete;
+
+    // Обслуживание запросов на сокете socket_path (не возвращает управление при успешном запуске).
+    // Возвращает false, если сокет не удалось создать.
+    bool serve(const std::filesystem::path& socket_path);
+
+    // Отправка запроса серверу и вывод ответа в output_descriptor. Сообщения об ошибках
+    // выводятся в stderr. Возвращает код завершения программы.
+    static int query(const std::filesystem::path& socket_path, const Request& request, int output_descriptor);
+
+protected:
+    std::filesystem::path root;                              // Корень обслуживаемого дерева.
+    bool recursively;                                        // Обслуживаются ли поддиректории.
+    size_t threads_number;                                   // Число потоков поиска.
+    Walker::Options options;                                 // Параметры поиска для всех запросов.
+
+    // Наблюдаемая директория и правила .gitignore и .ignore, действующие в ней и над ней.
+    struct Watch
+    {
+        std::string path;
+        std::shared_ptr<const Filter::Ignore> parent;        // Правила родительских директорий.
+        std::shared_ptr<const Filter::Ignore> ignore;        // Правила с учётом файлов правил директории.
+    };
+
+    std::mutex mutex_files;                                  // mutex для списка файлов и наблюдений.
+    std::set<std::string> files;                             // Обычные файлы дерева.
+    std::unordered_map<int, Watch> watches;                  // Наблюдаемые директории по дескрипторам inotify.
+    int inotify_descriptor = -1;                             // Дескриптор inotify.
+    int stop_pipe[2] = {-1, -1};                             // Канал для остановки потока наблюдения.
+    std::thread watcher;                                     // Поток обработки событий inotify.
+
+    std::mutex mutex_pool;                                   // mutex для пула потоков.
+    std::condition_variable condition_pool;                  // Оповещение пула о новом запросе.
+    std::condition_variable condition_done;                  // Оповещение о завершении запроса.
+    std::vector<std::thread> pool;                           // Потоки поиска.
+    Walker* current = nullptr;                               // Walker выполняемого запроса.
+    size_t generation = 0;                                   // Номер выполняемого запроса.
+    size_t running = 0;                                      // Число потоков, не завершивших запрос.
+    bool stopping = false;                                   // Запрошено завершение пула.
+    std::mutex mutex_run;                                    // Пул выполняет запросы по одному.
+
+    std::mutex mutex_clients;                                // mutex для числа соединений.
+    std::condition_variable condition_clients;               // Оповещение о закрытии соединения.
+    size_t clients = 0;                                      // Число обслуживаемых соединений.
+
+    static const uint32_t watch_mask;                        // События inotify, на которые подписан сервер.
+    static constexpr int request_timeout = 10000;            // Время ожидания запроса от клиента (мс).
+
+    void scan(const std::filesystem::path& directory, const std::shared_ptr<const Filter::Ignore>& parent);
+    void add_watch(const std::filesystem::path& directory, const std::shared_ptr<const Filter::Ignore>& parent,
+                   const std::shared_ptr<const Filter::Ignore>& ignore);
+    void remove_subtree(const std::string& directory);
+    void watch_loop();
+    void pool_loop(size_t thread_index);
+    void run(Walker& walker);
+    void handle(int client);
+    bool read_request(int client, std::string& message);
+
+private:
+
+};
+
+#endif
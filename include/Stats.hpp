@@ -0,0 +1,114 @@
+#ifndef PSEARCH_STATS
+#define PSEARCH_STATS
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+////////////////     Stats      ////////////////
+// Счётчики и таймеры горячего пути поиска. У каждого потока свой набор значений в отдельной строке
+// кэша; значения записывает только поток-владелец, поэтому сложение не требует атомарных операций
+// чтения-записи, а снимки (для периодического вывода прогресса) читаются без блокировок.
+// Сбор статистики компилируется, только если определён макрос PSEARCH_ENABLE_STATS (параметр CMake PSEARCH_STATS).
+class Stats
+{
+public:
+    enum Counter
+    {
+        files,        // Обработано файлов (целиком).
+        chunks,       // Обработано частей больших файлов.
+        bytes,        // Просмотрено байт.
+        directories,  // Обойдено директорий.
+        stat_calls,   // Вызовы stat при обходе.
+        lines,        // Выведено строк с вхождениями.
+        matches,      // Найдено вхождений.
+        steals,       // Директории, украденные у других потоков.
+        cache_hits,   // Файлы, результат для которых взят из кэша.
+        filtered,     // Файлы и директории, отсечённые фильтром обхода.
+        binary_files, // Пропущенные двоичные файлы.
+        async_reads,  // Файлы, прочитанные асинхронно.
+        compressed,   // Сжатые файлы, просмотренные с распаковкой.
+        counters_number
+    };
+
+    enum Timer
+    {
+        traversal,      // Чтение директорий.
+        io,             // Открытие и отображение файлов.
+        scan,           // Поиск в содержимом файлов.
+        output,         // Форматирование и передача вывода (включая ожидание потока записи).
+        queue_wait,     // Ожидание работы.
+        directory_lock, // Захват и удержание блокировок очередей директорий.
+        timers_number
+    };
+
+    // Значения одного потока.
+    struct alignas(64) Thread
+    {
+        std::atomic<uint64_t> counters[counters_number] = {}; // Значения счётчиков.
+        std::atomic<uint64_t> timers[timers_number] = {};     // Значения таймеров в наносекундах.
+
+        void add(Counter counter, uint64_t value)
+        { counters[counter].store(counters[counter].load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+        void add(Timer timer, uint64_t nanoseconds)
+        { timers[timer].store(timers[timer].load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed); }
+    };
+
+    // Измерение времени до конца области видимости.
+    class Scope
+    {
+    public:
+        Scope(Thread* init_thread, Timer init_timer) : thread(init_thread), timer(init_timer)
+        { if (thread) { started = std::chrono::steady_clock::now(); } }
+        ~Scope()
+        {
+            if (thread)
+            { thread->add(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count()); }
+        }
+
+        Scope(const Scope& other) = delete;
+        Scope& operator =(const Scope& other) = delete;
+
+    protected:
+        Thread* thread;
+        Timer timer;
+        std::chrono::steady_clock::time_point started;
+
+    private:
+
+    };
+
+    Stats(size_t threads_number, const std::string& init_engine);
+
+    Thread* thread(size_t thread_index) { return threads[thread_index].get(); }
+
+    // Вывод сводки в формате JSON. При per_thread также выводятся значения каждого потока.
+    void report(std::ostream& stream, bool per_thread) const;
+    // Вывод краткого снимка прогресса (одна строка JSON).
+    void progress(std::ostream& stream) const;
+
+protected:
+    std::vector<std::unique_ptr<Thread>> threads;   // Значения потоков.
+    std::string engine;                             // Название алгоритма поиска.
+    std::chrono::steady_clock::time_point started;  // Время начала поиска.
+
+    void sum(uint64_t (&counters)[counters_number], uint64_t (&timers)[timers_number]) const;
+    double elapsed() const;
+
+private:
+
+};
+
+// Макросы для сбора статистики; без PSEARCH_ENABLE_STATS раскрываются в пустые выражения.
+#ifdef PSEARCH_ENABLE_STATS
+#define PSEARCH_STATS_ADD(thread, counter, value) do { if (thread) { (thread)->add(Stats::counter, (value)); } } while (false)
+#define PSEARCH_STATS_SCOPE(thread, timer) Stats::Scope stats_scope_##timer((thread), Stats::timer)
+#else
+#define PSEARCH_STATS_ADD(thread, counter, value) do {} while (false)
+#define PSEARCH_STATS_SCOPE(thread, timer) do {} while (false)
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PSEARCH_TWOWAY
+#define PSEARCH_TWOWAY
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Searcher.hpp"
+
+////////////////     TwoWay     ////////////////
+// Класс, реализующий алгоритм Крошмора-Перрена (Two-Way). Образец делится в критической позиции:
+// правая часть сравнивается слева направо, левая - справа налево. Поиск выполняется за линейное время
+// с постоянной дополнительной памятью и хорошо подходит для длинных периодичных образцов, на которых
+// алгоритмы со сдвигами по таблице вырождаются. Находятся все (в том числе перекрывающиеся) вхождения.
+class TwoWay : public Searcher
+{
+public:
+    TwoWay(const std::string& init_string, bool init_case_insensitive = false);
+
+    using Searcher::search;
+    void search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+    const std::string& get_pattern(uint32_t) const { return pattern; }
+    bool crosses_lines() const { return pattern.find('\n') != std::string::npos; }
+    std::vector<std::string> required_literals() const
+    { return case_insensitive ? std::vector<std::string>() : std::vector<std::string>{pattern}; }
+
+protected:
+    std::string pattern;    // Строка-образец (без учёта регистра - в нижнем регистре).
+    bool case_insensitive;  // Поиск без учёта регистра букв ASCII.
+    size_t critical;        // Критическая позиция: начало правой части образца.
+    size_t period;          // Сдвиг после совпадения правой части.
+    bool periodic;          // Левая часть повторяется с периодом period (требуется запоминание совпавшего префикса).
+
+    template <bool fold>
+    void search_loop(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const;
+
+private:
+
+};
+
+#endif
@@ -1,42 +1,209 @@
 #ifndef PSEARCH_WALKER
 #define PSEARCH_WALKER
 #include <filesystem>
-#include <fstream>
-#include <queue>
+#include <deque>
+#include <vector>
 #include <thread>
-#include <shared_mutex>
+#include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <chrono>
+#include <sys/stat.h>
 
 #include "Searcher.hpp"
+#include "FileView.hpp"
+#include "MPMCQueue.hpp"
+#include "Output.hpp"
+#include "Stats.hpp"
+#include "ResultCache.hpp"
+#include "Filter.hpp"
+#include "Reader.hpp"
+#include "Decompressor.hpp"
 
 ////////////////     Walker     ////////////////
-// Класс для рекурсивного параллельного поиска.
+// Класс для рекурсивного параллельного поиска. Обход директорий распределён между всеми потоками:
+// у каждого потока есть своя очередь директорий, из которой свободные потоки крадут работу.
+// Найденные файлы передаются через общую ограниченную неблокирующую очередь.
 class Walker
 {
 public:
-    Walker(std::shared_ptr<Searcher> init_searcher);
+    // Параметры поиска.
+    struct Options
+    {
+        uintmax_t chunk_size = 64 * 1024 * 1024; // Файлы большего размера делятся на части для разных потоков (0 - не делить).
+        std::shared_ptr<Stats> stats;            // Сбор статистики (nullptr - не собирать).
+        std::shared_ptr<ResultCache> cache;      // Кэш результатов (nullptr - не использовать).
+        std::shared_ptr<const Filter> filter;    // Фильтр обхода и двоичных файлов (nullptr - без фильтрации).
+        Reader::Backend read_backend = Reader::Backend::none; // Асинхронное чтение файлов (none - отображение в память).
+        size_t read_depth = 32;                  // Число одновременных асинхронных чтений в потоке.
+        size_t read_memory = 64 * 1024 * 1024;   // Общий объём буфферов чтения всех потоков, делится между ними
+                                                 // поровну. Файлы больше четверти доли потока отображаются в память.
+        bool decompress = false;                 // Искать ли в файлах gzip и zstd, распаковывая их потоком.
+        size_t decompress_memory = 64 * 1024 * 1024; // Общий для всех потоков объём блоков распакованных данных.
+        size_t max_results = 0;                  // Поиск прекращается после вывода max_results строк (в режимах
+                                                 // вывода файлов - файлов); 0 - без ограничения.
+        bool adaptive = false;                   // Подбирать ли число активных потоков во время поиска.
+        size_t active_threads = 0;               // Начальное и наименьшее число активных потоков при adaptive
+                                                 // (0 - все потоки).
+        std::vector<int> cores;                  // Логические ядра для привязки потоков по номерам (пустой - без привязки).
+        std::string strip_prefix;                // Начало путей, не выводимое в результатах (например, корень дерева сервера).
+    };
+
+    Walker(std::shared_ptr<Searcher> init_searcher, std::shared_ptr<Output> init_output, size_t init_threads_number);
+    Walker(std::shared_ptr<Searcher> init_searcher, std::shared_ptr<Output> init_output, size_t init_threads_number, const Options& init_options);
 
     Walker(Walker&& other) = delete;
     Walker(const Walker& other) = delete;
     Walker& operator =(Walker&& other) = delete;
     Walker& operator =(const Walker& other) = delete;
 
-    void walk(std::filesystem::path& walk_path, bool recursively);
-    void search();
+    // Задание начального пути обхода (директории или отдельного файла). Вызывается до запуска потоков.
+    // Фильтр путей применяется к содержимому директорий; отдельный файл проверяется только по размеру.
+    void walk(const std::filesystem::path& walk_path, bool recursively);
+    // Задание списка файлов для поиска без обхода директорий (например, отобранных по индексу). Файлы
+    // проверяются только по размеру. Список делится на части, которые потоки разбирают как директории.
+    void walk(const std::vector<std::filesystem::path>& paths);
+    // Рабочий цикл потока с номером thread_index: обход директорий и поиск в файлах до завершения всей работы.
+    void search(size_t thread_index);
+    // Отмена поиска из любого потока: оставшиеся директории и файлы только снимаются с учёта, и рабочие
+    // циклы завершаются. Вхождения файлов, просмотр которых завершается после отмены, не выводятся.
+    void cancel();
 
 protected:
-    std::shared_ptr<Searcher> searcher;      // Класс для поиска в потоке ввода.
-    std::queue<std::filesystem::path> files; // Очередь файлов для обработки.
-    std::shared_mutex mutex_files;           // Разделяемый mutex для работы с очередью.
-    std::condition_variable condition_files; // Переменная состояния для работы с очередью.
-    std::mutex mutex_condition_files;        // mutex, отведённый для работы condition_files.
-    std::atomic<bool> walking = false;       // Переменная, сигнализирующая о происходящем обходе директорий.
-    std::mutex mutex_output;                 // mutex для вывода найденных вхождений.
-
-    size_t walk_buffer_size = 64;                    // Размер буффера путей файлов, ожидающих добавления в очередь.
-    size_t search_max_buffer_size = 1024 * 1024 * 4; // Минимальный суммарный вес файлов перед началом поииска.
+    // Файл, разделённый на части. Части обрабатываются разными потоками, вывод собирается последним из них.
+    // Границы частей выравниваются по началам строк, поэтому совпадения не пересекают границ.
+    struct FileJob
+    {
+        std::filesystem::path path;
+        size_t chunks_number;                                   // Число частей.
+        std::once_flag open_flag;                               // Файл открывается первым обратившимся потоком.
+        std::unique_ptr<FileView> view;                         // Содержимое файла.
+        std::vector<std::vector<Searcher::Entry>> chunk_entries; // Вхождения в каждой части (номера строк - от начала части).
+        std::vector<size_t> chunk_lines;                        // Число переводов строки в каждой части.
+        std::atomic<size_t> remaining;                          // Число необработанных частей.
+        bool binary = false;                                    // Пропускается ли файл как двоичный.
+        Decompressor::Format format = Decompressor::Format::none; // Сжатый файл распаковывается целиком потоком первой части.
+        std::deque<std::string> kept;                           // Копии строк вхождений в распакованном файле.
+    };
+
+    // Файл или часть файла для поиска. Размер определяется при добавлении в очередь, вне каких-либо блокировок.
+    struct Task
+    {
+        std::filesystem::path path;
+        uintmax_t size = 0;
+        std::shared_ptr<FileJob> job; // Файл, частью которого является задача (nullptr для целого файла).
+        size_t chunk = 0;             // Номер части.
+        ResultCache::Stamp stamp;     // Идентификатор и отметка изменения файла.
+    };
+
+    // Данные рабочего потока.
+    struct Worker
+    {
+        Worker(Output& output) : arena(output) {}
+
+        std::vector<Searcher::Entry> entries; // Вхождения в текущем файле.
+        Output::Arena arena;                  // Буффер вывода потока.
+        Stats::Thread* stats = nullptr;       // Статистика потока.
+        std::unique_ptr<Reader> reader;       // Асинхронное чтение файлов (nullptr - не используется).
+        std::unique_ptr<Decompressor> decompressor; // Распаковка сжатых файлов (создаётся при первом сжатом файле).
+        std::deque<std::string> kept;         // Копии строк вхождений, переживающие буффер поиска (для сжатых файлов).
+        std::atomic<uint64_t> io_time = 0;    // Время открытия и чтения файлов (нс, при Options::adaptive).
+        std::atomic<uint64_t> scan_time = 0;  // Время поиска в файлах (нс, при Options::adaptive).
+    };
+
+    // Директория, ожидающая обхода, и действующие в ней правила .gitignore и .ignore. Вместо директории
+    // в очереди может находиться часть [begin, end) списка файлов, заданного walk.
+    struct Directory
+    {
+        std::filesystem::path path;
+        std::shared_ptr<const Filter::Ignore> ignore;
+        std::shared_ptr<const std::vector<std::filesystem::path>> list = nullptr; // Список файлов (nullptr - директория).
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    // Очередь директорий потока. Владелец берёт директории с конца, остальные потоки крадут с начала.
+    struct DirectoryQueue
+    {
+        std::mutex mutex;
+        std::deque<Directory> directories;
+    };
+
+    std::shared_ptr<Searcher> searcher;                           // Класс для поиска в потоке ввода.
+    std::shared_ptr<Output> output;                               // Вывод найденных вхождений.
+    Options options;                                              // Параметры поиска.
+    std::vector<std::unique_ptr<Worker>> workers;                 // Данные рабочих потоков.
+    std::vector<std::unique_ptr<DirectoryQueue>> directory_queues; // Очереди директорий потоков.
+    std::shared_ptr<ReadPool> read_pool;                          // Пул потоков чтения (без io_uring).
+    std::shared_ptr<BlockPool> decompress_pool;                   // Пул блоков распакованных данных.
+    size_t read_memory = 0;                                       // Объём буфферов чтения одного потока.
+    MPMCQueue<Task> files;                                        // Очередь файлов для обработки.
+    std::atomic<size_t> pending = 0;                              // Число необработанных директорий и файлов.
+    std::atomic<size_t> queued_directories = 0;                   // Число директорий в очередях.
+    std::atomic<size_t> sleeping = 0;                             // Число ожидающих работы потоков.
+    std::mutex mutex_sleeping;                                    // mutex для ожидания работы.
+    std::condition_variable condition_sleeping;                   // Переменная состояния для ожидания работы.
+    bool recursively = true;                                      // Выполняется ли рекурсивный обход.
+    std::atomic<size_t> results = 0;                              // Число выведенных результатов.
+    std::atomic<bool> stopped = false;                            // Достигнуто ли ограничение числа результатов (или
+                                                                  // поиск отменён).
+    std::atomic<bool> cancelled = false;                          // Отменён ли поиск.
+    std::mutex mutex_visited;                                     // mutex для множества обойдённых директорий.
+    std::set<std::pair<uint64_t, uint64_t>> visited;              // Обойдённые директории (устройство и индексный
+                                                                  // дескриптор) при обходе по символическим ссылкам.
+    std::atomic<size_t> active_threads;                           // Число активных потоков; потоки с большими
+                                                                  // номерами ожидают, пока число не вырастет.
+    size_t min_active_threads;                                    // Наименьшее число активных потоков.
+    std::condition_variable condition_resting;                    // Ожидание неактивными потоками (с mutex_sleeping).
+    std::mutex mutex_adapt;                                       // mutex для подстройки параметров.
+    std::atomic<int64_t> next_adapt = 0;                          // Время следующей подстройки (нс, steady_clock).
+    uint64_t last_io_time = 0;                                    // Суммарное время чтения при последней подстройке.
+    uint64_t last_scan_time = 0;                                  // Суммарное время поиска при последней подстройке.
+
+    // Размеры пакетов подстраиваются по глубине очереди: пока потокам не хватает работы, файлы публикуются
+    // и забираются мелкими пакетами, при глубокой очереди - крупными, с меньшим числом обращений к ней.
+    static const size_t files_capacity = 4096;                     // Ёмкость очереди файлов.
+    std::atomic<size_t> walk_buffer_size = 64;                     // Размер буффера путей файлов, ожидающих добавления в очередь.
+    std::atomic<size_t> search_max_buffer_size = 1024 * 1024 * 4;  // Максимальный суммарный вес файлов, забираемых потоком за раз.
+    static const size_t min_walk_buffer_size = 8;
+    static const size_t max_walk_buffer_size = 512;
+    static const size_t min_search_buffer_size = 512 * 1024;
+    static const size_t max_search_buffer_size = 32 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds adapt_interval{20}; // Период подстройки.
+    static const size_t decompress_block_size = 1024 * 1024; // Размер блока распакованных данных.
+    static const size_t kept_page_size = 64 * 1024;          // Размер страницы копий строк вхождений.
+    static const size_t list_part_size = 256;                // Число файлов в части списка файлов.
+
+    void enumerate(const Directory& directory, size_t thread_index);
+    void enumerate_list(const Directory& part, size_t thread_index);
+    bool pop_directory(size_t thread_index, Directory& directory);
+    void push_directory(size_t thread_index, Directory&& directory);
+    bool visit(const struct stat& status);
+    void add_file(std::vector<Task>& buffer, std::filesystem::path&& path, const struct stat& status);
+    void push_files(std::vector<Task>& buffer, Worker& worker);
+    bool has_work() const;
+    void search_batch(const std::vector<Task>& batch, Worker& worker);
+    bool prefetchable(const Task& task) const;
+    void search_task(const Task& task, Worker& worker);
+    void search_file(const Task& task, Worker& worker);
+    void search_read(const Task& task, Worker& worker, uint64_t tag);
+    void scan_file(const Task& task, Worker& worker, const char* data, size_t size, bool opened);
+    void scan_compressed(Worker& worker, Decompressor::Format format, const char* data, size_t size,
+                         std::vector<Searcher::Entry>& entries, std::deque<std::string>& kept);
+    void search_chunk(const Task& task, Worker& worker);
+    void print_file(const std::filesystem::path& path, Worker& worker);
+    void count_entries(Worker& worker, const std::vector<Searcher::Entry>& entries);
+    size_t reserve(size_t count);
+    void finish(size_t count);
+    void wake(bool all);
+    void park();
+    void rest(size_t thread_index);
+    void resume();
+    void adapt();
 
 private:
 
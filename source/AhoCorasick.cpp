@@ -0,0 +1,156 @@
+#include "AhoCorasick.hpp"
+#include "CaseFold.hpp"
+#include <map>
+#include <queue>
+#include <algorithm>
+
+////////////////   AhoCorasick   ///////////////
+// Класс, реализующий автомат Ахо-Корасик для одновременного поиска нескольких образцов за один проход.
+// PUBLIC:
+AhoCorasick::AhoCorasick(const std::vector<std::string>& init_patterns, bool init_case_insensitive)
+{
+    patterns = init_patterns;
+    case_insensitive = init_case_insensitive;
+
+    // Строки, добавляемые в бор, и номера образцов, которым они соответствуют.
+    std::vector<std::pair<std::string, uint32_t>> keys;
+    for (uint32_t id = 0; id < patterns.size(); ++id)
+    {
+        if (!case_insensitive) { keys.push_back({patterns[id], id}); continue; }
+        for (std::string& variant : CaseFold::expand(patterns[id], max_variants)) { keys.push_back({std::move(variant), id}); }
+    }
+
+    // Построение бора во временном представлении.
+    std::vector<std::map<unsigned char, uint32_t>> children(1);
+    std::vector<std::vector<uint32_t>> ends(1);
+    for (auto& [key, id] : keys)
+    {
+        uint32_t node = 0;
+        for (char ch : key)
+        {
+            const unsigned char byte = static_cast<unsigned char>(ch);
+            auto found = children[node].find(byte);
+            if (found == children[node].end())
+            {
+                children[node][byte] = children.size();
+                node = children.size();
+                children.emplace_back();
+                ends.emplace_back();
+            }
+            else { node = found->second; }
+        }
+        ends[node].push_back(id);
+    }
+
+    // Обход в ширину: вычисление суффиксных ссылок, объединение выходов и новая нумерация состояний.
+    std::vector<uint32_t> fail(children.size(), 0);
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> index(children.size(), 0);
+    std::queue<uint32_t> queue;
+    queue.push(0);
+    while (!queue.empty())
+    {
+        const uint32_t node = queue.front();
+        queue.pop();
+        index[node] = order.size();
+        order.push_back(node);
+
+        for (auto& [byte, child] : children[node])
+        {
+            if (node)
+            {
+                uint32_t link = fail[node];
+                while (link && !children[link].count(byte)) { link = fail[link]; }
+                auto found = children[link].find(byte);
+                fail[child] = (found != children[link].end()) ? found->second : 0;
+            }
+
+            const std::vector<uint32_t>& inherited = ends[fail[child]];
+            ends[child].insert(ends[child].end(), inherited.begin(), inherited.end());
+            queue.push(child);
+        }
+    }
+
+    // Запись автомата в компактное представление.
+    states.resize(order.size());
+    for (uint32_t state = 0; state < order.size(); ++state)
+    {
+        const uint32_t node = order[state];
+        State& current = states[state];
+        current.fail = index[fail[node]];
+        current.edges_begin = edge_bytes.size();
+        current.outputs_begin = outputs.size();
+        current.outputs_count = ends[node].size();
+
+        // Без учёта регистра рёбра по строчным буквам дублируются рёбрами по заглавным.
+        std::map<unsigned char, uint32_t> edges;
+        for (auto& [byte, child] : children[node])
+        {
+            edges[byte] = index[child];
+            if (case_insensitive && byte >= 'a' && byte <= 'z') { edges[byte - ('a' - 'A')] = index[child]; }
+        }
+        current.edges_count = edges.size();
+        for (auto& [byte, target] : edges)
+        {
+            edge_bytes.push_back(byte);
+            edge_targets.push_back(target);
+        }
+        outputs.insert(outputs.end(), ends[node].begin(), ends[node].end());
+    }
+
+    // Плотная таблица переходов из корня: отсутствующие рёбра ведут обратно в корень.
+    std::fill(std::begin(root_table), std::end(root_table), 0);
+    for (uint32_t i = 0; i < states[0].edges_count; ++i) { root_table[edge_bytes[i]] = edge_targets[i]; }
+}
+
+void AhoCorasick::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    uint32_t state = 0;
+    LineTracker lines(begin, end, entries, limits);
+
+    // При достижении ограничения числа строк поиск продолжается до конца последней строки, чтобы
+    // для неё были найдены все образцы.
+    const char* scan_end = end;
+    for (const char* iter = begin; iter != scan_end; ++iter)
+    {
+        state = next(state, static_cast<unsigned char>(*iter));
+
+        const State& current = states[state];
+        for (uint32_t i = 0; i < current.outputs_count; ++i)
+        { lines.add(iter, outputs[current.outputs_begin + i]); }
+        if (current.outputs_count && lines.full()) { scan_end = lines.last_line_end(); }
+    }
+}
+
+bool AhoCorasick::crosses_lines() const
+{
+    return std::any_of(patterns.begin(), patterns.end(), [](const std::string& pattern) { return pattern.find('\n') != std::string::npos; });
+}
+
+// PROTECTED:
+uint32_t AhoCorasick::next(uint32_t state, unsigned char byte) const
+{
+    // Переход по суффиксным ссылкам, пока не найдётся ребро или не будет достигнут корень.
+    while (state)
+    {
+        const State& current = states[state];
+        const unsigned char* bytes_begin = edge_bytes.data() + current.edges_begin;
+        const unsigned char* bytes_end = bytes_begin + current.edges_count;
+
+        // Рёбра отсортированы: для малого числа рёбер используется линейный поиск, иначе - двоичный.
+        const unsigned char* found;
+        if (current.edges_count <= 8)
+        { found = std::find(bytes_begin, bytes_end, byte); }
+        else
+        {
+            found = std::lower_bound(bytes_begin, bytes_end, byte);
+            if (found != bytes_end && *found != byte) { found = bytes_end; }
+        }
+
+        if (found != bytes_end) { return edge_targets[current.edges_begin + (found - bytes_begin)]; }
+        state = current.fail;
+    }
+    return root_table[byte];
+}
+
+// PRIVATE:
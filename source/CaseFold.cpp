@@ -0,0 +1,159 @@
+#include "CaseFold.hpp"
+#include <unordered_map>
+#include <stdexcept>
+
+// Декодирование символа UTF-8, начинающегося в позиции position. Возвращает длину последовательности
+// или 0, если последовательность некорректна.
+static size_t decode(const std::string& text, size_t position, uint32_t& codepoint)
+{
+    const unsigned char first = text[position];
+    size_t length;
+    if (first < 0x80) { codepoint = first; return 1; }
+    else if ((first & 0xE0) == 0xC0) { length = 2; codepoint = first & 0x1F; }
+    else if ((first & 0xF0) == 0xE0) { length = 3; codepoint = first & 0x0F; }
+    else if ((first & 0xF8) == 0xF0) { length = 4; codepoint = first & 0x07; }
+    else { return 0; }
+
+    if (position + length > text.size()) { return 0; }
+    for (size_t i = 1; i < length; ++i)
+    {
+        const unsigned char byte = text[position + i];
+        if ((byte & 0xC0) != 0x80) { return 0; }
+        codepoint = (codepoint << 6) | (byte & 0x3F);
+    }
+    return length;
+}
+
+// Кодирование кодовой точки (не больше CaseFold::max_cased) в UTF-8.
+static std::string encode(uint32_t codepoint)
+{
+    std::string bytes;
+    if (codepoint < 0x80) { bytes.push_back(codepoint); }
+    else if (codepoint < 0x800)
+    {
+        bytes.push_back(0xC0 | (codepoint >> 6));
+        bytes.push_back(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+        bytes.push_back(0xE0 | (codepoint >> 12));
+        bytes.push_back(0x80 | ((codepoint >> 6) & 0x3F));
+        bytes.push_back(0x80 | (codepoint & 0x3F));
+    }
+    return bytes;
+}
+
+////////////////    CaseFold    ////////////////
+// Простое сопоставление регистров.
+// PUBLIC:
+uint32_t CaseFold::fold(uint32_t codepoint)
+{
+    auto in = [codepoint](uint32_t low, uint32_t high) { return low <= codepoint && codepoint <= high; };
+
+    // Блоки, в которых заглавная и строчная буквы отстоят на постоянную величину.
+    if (in('A', 'Z')) { return codepoint + 32; }
+    if (in(0xC0, 0xDE) && codepoint != 0xD7) { return codepoint + 32; }
+    if (in(0x391, 0x3AB) && codepoint != 0x3A2) { return codepoint + 32; }
+    if (in(0x388, 0x38A)) { return codepoint + 37; }
+    if (in(0x38E, 0x38F)) { return codepoint + 63; }
+    if (in(0x400, 0x40F)) { return codepoint + 80; }
+    if (in(0x410, 0x42F)) { return codepoint + 32; }
+    if (in(0x531, 0x556)) { return codepoint + 48; }
+
+    // Блоки чередующихся пар: заглавная буква - чётная или нечётная кодовая точка.
+    if ((in(0x100, 0x12F) || in(0x132, 0x137) || in(0x14A, 0x177) || in(0x3D8, 0x3EF) || in(0x460, 0x481) ||
+         in(0x48A, 0x4BF) || in(0x4D0, 0x52F) || in(0x1E00, 0x1E95) || in(0x1EA0, 0x1EFF)))
+    { return codepoint | 1; }
+    if (in(0x139, 0x148) || in(0x179, 0x17E) || in(0x4C1, 0x4CE)) { return codepoint + (codepoint & 1); }
+
+    // Отдельные пары.
+    switch (codepoint)
+    {
+        case 0x178: { return 0xFF; }
+        case 0x386: { return 0x3AC; }
+        case 0x38C: { return 0x3CC; }
+        case 0x3C2: { return 0x3C3; } // Конечная сигма.
+        case 0x4C0: { return 0x4CF; }
+        default: { return codepoint; }
+    }
+}
+
+std::vector<uint32_t> CaseFold::variants(uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        if (!is_ascii_letter(codepoint)) { return {codepoint}; }
+        const unsigned char lower = fold_ascii(codepoint);
+        return {lower, static_cast<uint32_t>(lower - ('a' - 'A'))};
+    }
+
+    // Обратное отображение строится один раз: для каждой строчной буквы - все буквы, приводимые к ней.
+    static const std::unordered_map<uint32_t, std::vector<uint32_t>> classes = []()
+    {
+        std::unordered_map<uint32_t, std::vector<uint32_t>> result;
+        for (uint32_t other = 0x80; other <= max_cased; ++other)
+        {
+            const uint32_t lower = fold(other);
+            if (lower != other) { result[lower].push_back(other); }
+        }
+        return result;
+    }();
+
+    const uint32_t lower = fold(codepoint);
+    std::vector<uint32_t> result = {lower};
+    auto found = classes.find(lower);
+    if (found != classes.end()) { result.insert(result.end(), found->second.begin(), found->second.end()); }
+    return result;
+}
+
+bool CaseFold::has_unicode_cases(const std::string& text)
+{
+    for (size_t position = 0; position < text.size();)
+    {
+        uint32_t codepoint;
+        const size_t length = decode(text, position, codepoint);
+        if (!length) { ++position; continue; }
+        if (codepoint >= 0x80 && variants(codepoint).size() > 1) { return true; }
+        position += length;
+    }
+    return false;
+}
+
+std::vector<std::string> CaseFold::expand(const std::string& text, size_t limit)
+{
+    std::vector<std::string> result = {std::string()};
+    for (size_t position = 0; position < text.size();)
+    {
+        uint32_t codepoint;
+        const size_t length = decode(text, position, codepoint);
+
+        // Байты ASCII и некорректные последовательности добавляются ко всем вариантам без перебора.
+        if (length <= 1 || codepoint > max_cased)
+        {
+            const size_t count = length ? length : 1;
+            for (std::string& item : result)
+            {
+                for (size_t i = 0; i < count; ++i) { item.push_back(fold_ascii(text[position + i])); }
+            }
+            position += count;
+            continue;
+        }
+        position += length;
+
+        const std::vector<uint32_t> options = variants(codepoint);
+        if (result.size() * options.size() > limit) { throw std::length_error("слишком много вариантов регистра"); }
+
+        std::vector<std::string> next;
+        next.reserve(result.size() * options.size());
+        for (const std::string& item : result)
+        {
+            for (uint32_t option : options) { next.push_back(item + encode(option)); }
+        }
+        result.swap(next);
+    }
+    return result;
+}
+
+// PROTECTED:
+
+// PRIVATE:
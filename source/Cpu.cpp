@@ -0,0 +1,123 @@
+#include "Cpu.hpp"
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+////////////////      Cpu       ////////////////
+// Сведения о ядрах, доступных процессу.
+// PUBLIC:
+size_t Cpu::available()
+{
+    size_t count = std::thread::hardware_concurrency();
+    if (!count) { count = 1; }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (!sched_getaffinity(0, sizeof(set), &set)) { count = std::min<size_t>(count, std::max(CPU_COUNT(&set), 1)); }
+
+    return std::max<size_t>(std::min(count, cgroup_limit()), 1);
+}
+
+std::vector<int> Cpu::cores()
+{
+    std::vector<int> allowed;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set)) { return allowed; }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &set)) { allowed.push_back(cpu); }
+    }
+
+    // Первое логическое ядро каждого физического (пакет и номер ядра из sysfs) идёт в начало списка.
+    std::vector<std::pair<long, long>> seen;
+    std::vector<int> first;
+    std::vector<int> siblings;
+    for (int cpu : allowed)
+    {
+        const std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        const std::pair<long, long> core(read_number(topology + "physical_package_id"), read_number(topology + "core_id"));
+        if (core.second >= 0 && std::find(seen.begin(), seen.end(), core) != seen.end()) { siblings.push_back(cpu); }
+        else
+        {
+            seen.push_back(core);
+            first.push_back(cpu);
+        }
+    }
+    first.insert(first.end(), siblings.begin(), siblings.end());
+    return first;
+}
+
+bool Cpu::pin(const std::vector<int>& cores, size_t index)
+{
+    if (cores.empty()) { return false; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cores[index % cores.size()], &set);
+    return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// PROTECTED:
+size_t Cpu::cgroup_limit()
+{
+    size_t limit = SIZE_MAX;
+    auto apply = [&limit](long quota, long period)
+    {
+        if (quota > 0 && period > 0) { limit = std::min<size_t>(limit, (quota + period - 1) / period); }
+    };
+
+    // cgroup v2: квота "<quota> <period>" или "max <period>" в cpu.max группы процесса и её предков.
+    std::string text;
+    if (read_text("/proc/self/cgroup", text))
+    {
+        std::istringstream lines(text);
+        for (std::string line; std::getline(lines, line);)
+        {
+            if (line.compare(0, 3, "0::") != 0) { continue; }
+            for (std::string group = line.substr(3);; group = group.substr(0, group.rfind('/')))
+            {
+                std::string cpu_max;
+                if (read_text("/sys/fs/cgroup" + group + "/cpu.max", cpu_max))
+                {
+                    std::istringstream fields(cpu_max);
+                    std::string quota;
+                    long period = 0;
+                    if (fields >> quota >> period && quota != "max") { apply(std::atol(quota.c_str()), period); }
+                }
+                if (group.empty() || group == "/") { break; }
+            }
+        }
+    }
+
+    // cgroup v1: cpu.cfs_quota_us (-1 - без ограничения) и cpu.cfs_period_us.
+    for (const char* directory : {"/sys/fs/cgroup/cpu/", "/sys/fs/cgroup/cpu,cpuacct/"})
+    { apply(read_number(std::string(directory) + "cpu.cfs_quota_us"), read_number(std::string(directory) + "cpu.cfs_period_us")); }
+    return limit;
+}
+
+bool Cpu::read_text(const std::string& path, std::string& text)
+{
+    std::ifstream stream(path);
+    if (!stream) { return false; }
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+long Cpu::read_number(const std::string& path)
+{
+    std::string text;
+    if (!read_text(path, text)) { return -1; }
+    try { return std::stol(text); }
+    catch (const std::logic_error&) { return -1; }
+}
+
+// PRIVATE:
@@ -0,0 +1,260 @@
+#include "Decompressor.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#ifdef PSEARCH_ENABLE_GZIP
+#include <zlib.h>
+#endif
+#ifdef PSEARCH_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+////////////////   BlockPool    ////////////////
+// Общий пул блоков распакованных данных.
+// PUBLIC:
+BlockPool::BlockPool(size_t init_block_size, size_t init_blocks_number)
+{
+    block_size = init_block_size;
+    blocks_number = std::max<size_t>(init_blocks_number, 1);
+}
+
+BlockPool::Block* BlockPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_blocks);
+    if (free_blocks.empty() && blocks.size() < blocks_number)
+    {
+        blocks.push_back(std::make_unique<Block>());
+        blocks.back()->data.reset(new char[block_size]);
+        return blocks.back().get();
+    }
+    condition_blocks.wait(lock, [this]() { return !free_blocks.empty(); });
+    Block* block = free_blocks.back();
+    free_blocks.pop_back();
+    return block;
+}
+
+void BlockPool::release(Block* block)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_blocks);
+        block->size = 0;
+        free_blocks.push_back(block);
+    }
+    condition_blocks.notify_one();
+}
+
+// PROTECTED:
+
+// PRIVATE:
+
+////////////////  Decompressor  ////////////////
+// Потоковая распаковка сжатых файлов.
+// PUBLIC:
+Decompressor::Decompressor(std::shared_ptr<BlockPool> init_pool)
+{
+    pool = init_pool;
+    thread = std::thread(&Decompressor::work, this);
+}
+
+Decompressor::~Decompressor()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_state);
+        stopping = true;
+    }
+    condition_state.notify_all();
+    thread.join();
+}
+
+void Decompressor::start(Format init_format, const char* begin, const char* end)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_state);
+        format = init_format;
+        input_begin = begin;
+        input_end = end;
+        pending = true;
+        producing = true;
+        cancelled = false;
+        failed = false;
+    }
+    condition_state.notify_all();
+}
+
+BlockPool::Block* Decompressor::next()
+{
+    BlockPool::Block* block = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mutex_state);
+        condition_state.wait(lock, [this]() { return !ready.empty() || !producing; });
+        if (ready.empty()) { return nullptr; }
+        block = ready.front();
+        ready.pop_front();
+    }
+    condition_state.notify_all();
+    return block;
+}
+
+bool Decompressor::finish()
+{
+    // Нераспакованные блоки возвращаются в пул до ожидания: поток распаковки может ждать именно их.
+    std::unique_lock<std::mutex> lock(mutex_state);
+    cancelled = true;
+    for (BlockPool::Block* block : ready) { pool->release(block); }
+    ready.clear();
+    condition_state.notify_all();
+    condition_state.wait(lock, [this]() { return !producing; });
+    return !failed;
+}
+
+Decompressor::Format Decompressor::detect(const char* data, size_t size)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    #ifdef PSEARCH_ENABLE_GZIP
+    if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) { return Format::gzip; }
+    #endif
+    #ifdef PSEARCH_ENABLE_ZSTD
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD) { return Format::zstd; }
+    #endif
+    (void)bytes;
+    (void)size;
+    return Format::none;
+}
+
+// PROTECTED:
+void Decompressor::work()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_state);
+            condition_state.wait(lock, [this]() { return pending || stopping; });
+            if (stopping) { return; }
+            pending = false;
+        }
+
+        bool valid = false;
+        if (format == Format::gzip) { valid = inflate_gzip(); }
+        else if (format == Format::zstd) { valid = decompress_zstd(); }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_state);
+            failed = !valid;
+            producing = false;
+        }
+        condition_state.notify_all();
+    }
+}
+
+bool Decompressor::push(BlockPool::Block* block)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_state);
+        condition_state.wait(lock, [this]() { return ready.size() < max_ready || cancelled; });
+        if (cancelled)
+        {
+            pool->release(block);
+            return false;
+        }
+        ready.push_back(block);
+    }
+    condition_state.notify_all();
+    return true;
+}
+
+bool Decompressor::inflate_gzip()
+{
+    #ifdef PSEARCH_ENABLE_GZIP
+    // 15 + 32: окно наибольшего размера и автоматическое определение заголовка gzip или zlib.
+    z_stream stream = {};
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) { return false; }
+
+    // Размер входа для zlib ограничен типом uInt, поэтому большие файлы подаются частями.
+    const char* input = input_begin;
+    auto refill = [&stream, &input, this]()
+    {
+        const size_t size = std::min<size_t>(input_end - input, UINT_MAX / 2);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+        stream.avail_in = size;
+        input += size;
+    };
+    refill();
+
+    bool valid = true;
+    bool finished = false;
+    while (!finished)
+    {
+        BlockPool::Block* block = pool->acquire();
+        stream.next_out = reinterpret_cast<Bytef*>(block->data.get());
+        stream.avail_out = pool->get_block_size();
+        while (stream.avail_out)
+        {
+            if (!stream.avail_in && input < input_end) { refill(); }
+            const int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END)
+            {
+                // Файл может состоять из нескольких последовательных потоков gzip.
+                if (!stream.avail_in && input == input_end) { finished = true; break; }
+                inflateReset(&stream);
+                continue;
+            }
+            if (status != Z_OK)
+            {
+                valid = false;
+                finished = true;
+                break;
+            }
+        }
+        block->size = pool->get_block_size() - stream.avail_out;
+        if (!push(block)) { break; }
+    }
+    inflateEnd(&stream);
+    return valid;
+    #else
+    return false;
+    #endif
+}
+
+bool Decompressor::decompress_zstd()
+{
+    #ifdef PSEARCH_ENABLE_ZSTD
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (!stream) { return false; }
+    ZSTD_initDStream(stream);
+
+    // Последовательные кадры распаковываются подряд. Если вход исчерпан, а блок не заполнен, всё
+    // распакованное уже передано; незавершённый кадр означает обрезанные данные.
+    ZSTD_inBuffer input = {input_begin, static_cast<size_t>(input_end - input_begin), 0};
+    bool valid = true;
+    bool finished = false;
+    while (!finished)
+    {
+        BlockPool::Block* block = pool->acquire();
+        ZSTD_outBuffer output = {block->data.get(), pool->get_block_size(), 0};
+        while (output.pos < output.size)
+        {
+            const size_t result = ZSTD_decompressStream(stream, &output, &input);
+            if (ZSTD_isError(result))
+            {
+                valid = false;
+                finished = true;
+                break;
+            }
+            if (input.pos == input.size && output.pos < output.size)
+            {
+                valid = (result == 0);
+                finished = true;
+                break;
+            }
+        }
+        block->size = output.pos;
+        if (!push(block)) { break; }
+    }
+    ZSTD_freeDStream(stream);
+    return valid;
+    #else
+    return false;
+    #endif
+}
+
+// PRIVATE:
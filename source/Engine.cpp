@@ -0,0 +1,136 @@
+#include "Engine.hpp"
+#include "SIMD.hpp"
+#include "Horspool.hpp"
+#include "TwoWay.hpp"
+#include "AhoCorasick.hpp"
+#include "Regex.hpp"
+#include "CaseFold.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <array>
+#include <algorithm>
+
+////////////////     Engine     ////////////////
+// Выбор и создание объекта поиска по параметрам запроса.
+// PUBLIC:
+std::string Engine::choose(const Query& query)
+{
+    if (!query.patterns.empty()) { return "aho-corasick"; }
+    if (query.regex) { return "regex"; }
+
+    // Варианты регистра символов вне ASCII различаются не только последним байтом, поэтому такой образец
+    // ищется как литерал ленивым ДКА.
+    if (query.case_insensitive && CaseFold::has_unicode_cases(query.pattern)) { return "regex"; }
+    if (!query.engine.empty() && query.engine != "auto") { return query.engine; }
+
+    // Статистика образца: длина и число различных байтов.
+    const std::string& pattern = query.pattern;
+    std::array<bool, 256> present = {};
+    for (char ch : pattern) { present[static_cast<unsigned char>(ch)] = true; }
+    const size_t size = pattern.size();
+    const size_t distinct = std::count(present.begin(), present.end(), true);
+
+    // С векторными инструкциями фильтр по двум редким байтам почти всегда упирается в скорость памяти.
+    // Исключение - длинные образцы из немногих повторяющихся байтов: оба байта фильтра часто встречаются
+    // в тексте, а сдвиги Хорспула остаются длинными.
+    if (SIMD::best_kernel() != SIMD::Kernel::scalar)
+    {
+        if (size >= 24 && distinct >= 4 && distinct * 4 <= size) { return "horspool"; }
+        return "simd";
+    }
+
+    // Без векторных инструкций короткие образцы ищутся через memchr, длинные - сдвигами Хорспула;
+    // на образцах из одного-двух байтов сдвиги вырождаются, и линейное время гарантирует Two-Way.
+    if (size < 4) { return "simd"; }
+    if (distinct <= 2) { return "twoway"; }
+    return "horspool";
+}
+
+std::shared_ptr<Searcher> Engine::create(const Query& query)
+{
+    // Явно заданный алгоритм одного образца не заменяется ленивым ДКА молча.
+    const bool explicit_engine = !query.engine.empty() && query.engine != "auto";
+    if (explicit_engine && query.patterns.empty() && !query.regex && query.case_insensitive && CaseFold::has_unicode_cases(query.pattern))
+    { throw std::invalid_argument("алгоритм " + query.engine + " не ищет без учёта регистра символы вне ASCII, такой образец ищется только ленивым ДКА"); }
+    return create(query, choose(query));
+}
+
+const std::vector<std::string>& Engine::single_pattern_engines()
+{
+    static const std::vector<std::string> names = {"auto", "kmp", "simd", "horspool", "twoway"};
+    return names;
+}
+
+// PROTECTED:
+std::shared_ptr<Searcher> Engine::create(const Query& query, const std::string& name)
+{
+    if (query.patterns.empty() && query.pattern.empty()) { throw std::invalid_argument("образец не может быть пустым"); }
+
+    const bool fold = query.case_insensitive;
+    if (name == "aho-corasick") { return std::make_shared<AhoCorasick>(query.patterns, fold); }
+    if (name == "regex") { return std::make_shared<Regex>(query.regex ? query.pattern : Regex::escape(query.pattern), fold); }
+    if (name == "kmp") { return std::make_shared<KMP>(query.pattern, fold); }
+    if (name == "simd") { return std::make_shared<SIMD>(query.pattern, SIMD::best_kernel(), fold); }
+    if (name == "horspool") { return std::make_shared<Horspool>(query.pattern, fold); }
+    if (name == "twoway") { return std::make_shared<TwoWay>(query.pattern, fold); }
+    throw std::invalid_argument("неизвестный алгоритм поиска " + name);
+}
+
+// PRIVATE:
+
+
+////////////////   Crosscheck   ////////////////
+// Объект поиска для самопроверки.
+// PUBLIC:
+Crosscheck::Crosscheck(std::shared_ptr<Searcher> init_primary, std::shared_ptr<Searcher> init_secondary,
+                       const std::string& init_primary_name, const std::string& init_secondary_name)
+{
+    primary = init_primary;
+    secondary = init_secondary;
+    primary_name = init_primary_name;
+    secondary_name = init_secondary_name;
+}
+
+void Crosscheck::set_limits(const Limits& init_limits)
+{
+    Searcher::set_limits(init_limits);
+    primary->set_limits(init_limits);
+    secondary->set_limits(init_limits);
+}
+
+void Crosscheck::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    const size_t first = entries.size();
+    primary->search(begin, end, entries);
+    std::vector<Searcher::Entry> expected;
+    secondary->search(begin, end, expected);
+
+    // Сравниваются все поля найденных строк.
+    auto same = [](const Searcher::Entry& left, const Searcher::Entry& right)
+    {
+        return left.line_number == right.line_number && left.line == right.line &&
+               left.entries_number == right.entries_number && left.patterns == right.patterns;
+    };
+    const size_t found = entries.size() - first;
+    size_t mismatch = 0;
+    while (mismatch < found && mismatch < expected.size() && same(entries[first + mismatch], expected[mismatch])) { ++mismatch; }
+    if (mismatch == found && mismatch == expected.size()) { return; }
+
+    // Описание первого расхождения.
+    auto describe = [](const std::vector<Searcher::Entry>& list, size_t begin, size_t index)
+    {
+        if (begin + index >= list.size()) { return std::string("<нет строки>"); }
+        const Searcher::Entry& entry = list[begin + index];
+        return "строка " + std::to_string(entry.line_number) + ", вхождений " + std::to_string(entry.entries_number) + ": " + std::string(entry.line);
+    };
+    std::cerr << "Самопроверка: результаты " << primary_name << " и " << secondary_name << " различаются"
+              << " (найдено строк: " << found << " и " << expected.size() << ")." << std::endl
+              << primary_name << ": " << describe(entries, first, mismatch) << std::endl
+              << secondary_name << ": " << describe(expected, 0, mismatch) << std::endl;
+    std::abort();
+}
+
+// PROTECTED:
+
+// PRIVATE:
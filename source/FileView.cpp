@@ -0,0 +1,63 @@
+#include "FileView.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+
+////////////////    FileView    ////////////////
+// Класс для доступа к содержимому файла как к непрерывному диапазону байт.
+// PUBLIC:
+FileView::FileView(const std::filesystem::path& path)
+{
+    int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) { return; }
+    opened = true;
+
+    // Обычные файлы ненулевого размера отображаются в память. Файлы нулевого размера
+    // (например, из /proc) и специальные файлы считываются до конца в буффер.
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+    {
+        void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address != MAP_FAILED)
+        {
+            madvise(address, status.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(address);
+            data_size = status.st_size;
+            mapped = true;
+        }
+    }
+
+    if (!mapped) { read_all(descriptor); }
+    close(descriptor);
+}
+
+FileView::~FileView()
+{
+    if (mapped) { munmap(const_cast<char*>(data), data_size); }
+}
+
+// PROTECTED:
+void FileView::read_all(int descriptor)
+{
+    size_t filled = 0;
+    while (true)
+    {
+        if (buffer.size() < filled + read_block_size) { buffer.resize(filled + read_block_size); }
+
+        ssize_t count = read(descriptor, buffer.data() + filled, buffer.size() - filled);
+        if (count < 0)
+        {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        if (count == 0) { break; }
+        filled += count;
+    }
+
+    data = buffer.data();
+    data_size = filled;
+}
+
+// PRIVATE:
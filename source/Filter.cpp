@@ -0,0 +1,304 @@
+#include "Filter.hpp"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Длина пути директории вместе с разделителем, после которого начинаются имена её записей.
+static size_t prefix_size(const std::string& directory)
+{
+    if (!directory.empty() && directory.back() == '/') { return directory.size(); }
+    return directory.size() + 1;
+}
+
+////////////////      Glob      ////////////////
+// Скомпилированный шаблон в синтаксисе .gitignore.
+// PUBLIC:
+Filter::Glob::Glob(const std::string& text)
+{
+    pattern = text;
+    if (!pattern.empty() && pattern[0] == '!')
+    {
+        negated = true;
+        pattern.erase(0, 1);
+    }
+    while (!pattern.empty() && pattern.back() == '/')
+    {
+        directory_only = true;
+        pattern.pop_back();
+    }
+    if (!pattern.empty() && pattern[0] == '/')
+    {
+        anchored = true;
+        pattern.erase(0, 1);
+    }
+    if (pattern.find('/') != std::string::npos) { anchored = true; }
+
+    // Вид шаблона определяет способ сравнения.
+    const char* special = "*?[\\";
+    if (pattern.find_first_of(special) == std::string::npos) { kind = Kind::literal; }
+    else if (!anchored && pattern[0] == '*' && pattern.find_first_of(special, 1) == std::string::npos) { kind = Kind::suffix; }
+    else { kind = Kind::general; }
+}
+
+bool Filter::Glob::matches(const char* path, size_t path_size, const char* name, size_t name_size, bool directory) const
+{
+    if (directory_only && !directory) { return false; }
+    const char* text = anchored ? path : name;
+    const size_t text_size = anchored ? path_size : name_size;
+    switch (kind)
+    {
+        case Kind::literal: { return text_size == pattern.size() && !std::memcmp(text, pattern.data(), text_size); }
+        case Kind::suffix:
+        {
+            const size_t suffix_size = pattern.size() - 1;
+            return text_size >= suffix_size && !std::memcmp(text + text_size - suffix_size, pattern.data() + 1, suffix_size);
+        }
+        default: { return match(pattern.data(), pattern.data() + pattern.size(), text, text + text_size); }
+    }
+}
+
+// PROTECTED:
+bool Filter::Glob::match(const char* pattern, const char* pattern_end, const char* text, const char* text_end)
+{
+    while (pattern < pattern_end)
+    {
+        if (*pattern == '*')
+        {
+            // '**' совпадает с любой последовательностью, включая '/'; '**/' - с любым числом директорий.
+            if (pattern + 1 < pattern_end && pattern[1] == '*')
+            {
+                pattern += 2;
+                if (pattern < pattern_end && *pattern == '/')
+                {
+                    ++pattern;
+                    for (const char* position = text;;)
+                    {
+                        if (match(pattern, pattern_end, position, text_end)) { return true; }
+                        position = static_cast<const char*>(std::memchr(position, '/', text_end - position));
+                        if (!position) { return false; }
+                        ++position;
+                    }
+                }
+                for (const char* position = text; position <= text_end; ++position)
+                {
+                    if (match(pattern, pattern_end, position, text_end)) { return true; }
+                }
+                return false;
+            }
+
+            // '*' совпадает с любой последовательностью в пределах одного имени.
+            ++pattern;
+            for (const char* position = text;; ++position)
+            {
+                if (match(pattern, pattern_end, position, text_end)) { return true; }
+                if (position == text_end || *position == '/') { return false; }
+            }
+        }
+
+        if (text == text_end) { return false; }
+        if (*pattern == '?')
+        {
+            if (*text == '/') { return false; }
+        }
+        else if (*pattern == '[')
+        {
+            const char* class_end = pattern;
+            if (!match_class(class_end, pattern_end, *text)) { return false; }
+            pattern = class_end;
+            ++text;
+            continue;
+        }
+        else
+        {
+            if (*pattern == '\\' && pattern + 1 < pattern_end) { ++pattern; }
+            if (*pattern != *text) { return false; }
+        }
+        ++pattern;
+        ++text;
+    }
+    return text == text_end;
+}
+
+bool Filter::Glob::match_class(const char*& pattern, const char* pattern_end, char ch)
+{
+    // Незакрытая скобка сравнивается как обычный символ.
+    const char* position = pattern + 1;
+    const bool negation = position < pattern_end && (*position == '!' || *position == '^');
+    if (negation) { ++position; }
+
+    bool found = false;
+    bool first = true;
+    for (; position < pattern_end && (first || *position != ']'); first = false)
+    {
+        unsigned char low = *position++;
+        if (low == '\\' && position < pattern_end) { low = *position++; }
+        unsigned char high = low;
+        if (position + 1 < pattern_end && *position == '-' && position[1] != ']')
+        {
+            high = position[1];
+            position += 2;
+        }
+        if (low <= static_cast<unsigned char>(ch) && static_cast<unsigned char>(ch) <= high) { found = true; }
+    }
+    if (position >= pattern_end)
+    {
+        pattern += 1;
+        return ch == '[';
+    }
+    pattern = position + 1;
+    return found != negation && ch != '/';
+}
+
+// PRIVATE:
+
+////////////////     Filter     ////////////////
+// Фильтр путей при обходе директорий.
+// PUBLIC:
+Filter::Filter(const Options& init_options)
+{
+    options = init_options;
+    for (const std::string& text : options.globs)
+    {
+        Glob glob(text);
+        (glob.is_negated() ? excludes : includes).push_back(std::move(glob));
+    }
+}
+
+std::shared_ptr<const Filter::Ignore> Filter::root(const std::string& directory) const
+{
+    const size_t size = prefix_size(directory);
+    std::shared_ptr<const Ignore> rules = std::make_shared<const Ignore>(Ignore{nullptr, size, size, {}, ""});
+    if (!options.ignore_files) { return rules; }
+
+    // Поиск корня репозитория среди директорий выше начальной. Вне репозитория учитываются только
+    // файлы правил внутри начальной директории.
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(directory, error).lexically_normal();
+    if (error) { return rules; }
+    if (!absolute.has_filename()) { absolute = absolute.parent_path(); }
+    std::vector<std::filesystem::path> ancestors;
+    for (std::filesystem::path current = absolute; !std::filesystem::exists(current / ".git", error);)
+    {
+        if (current == current.parent_path()) { return rules; }
+        current = current.parent_path();
+        ancestors.push_back(current);
+    }
+
+    // Правила читаются от корня репозитория вниз; пути записей дополняются путём начальной директории
+    // относительно директории правил.
+    const std::string absolute_text = absolute.native();
+    for (auto ancestor = ancestors.rbegin(); ancestor != ancestors.rend(); ++ancestor)
+    {
+        int descriptor = open(ancestor->c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (descriptor < 0) { continue; }
+        std::vector<Glob> globs;
+        load(descriptor, ".gitignore", globs);
+        load(descriptor, ".ignore", globs);
+        close(descriptor);
+        if (globs.empty()) { continue; }
+
+        std::string prefix = absolute_text.substr(prefix_size(ancestor->native())) + "/";
+        rules = std::make_shared<const Ignore>(Ignore{rules, size, size, std::move(globs), std::move(prefix)});
+    }
+    return rules;
+}
+
+std::shared_ptr<const Filter::Ignore> Filter::enter(const std::string& directory, int descriptor, const std::shared_ptr<const Ignore>& parent) const
+{
+    if (!options.ignore_files) { return parent; }
+
+    // Правила .ignore приоритетнее правил .gitignore той же директории.
+    std::vector<Glob> globs;
+    load(descriptor, ".gitignore", globs);
+    load(descriptor, ".ignore", globs);
+    if (globs.empty()) { return parent; }
+    return std::make_shared<const Ignore>(Ignore{parent, prefix_size(directory), parent->root_size, std::move(globs), ""});
+}
+
+bool Filter::allows(const std::string& path, const char* name, bool directory, const Ignore& ignore) const
+{
+    if (!options.hidden && name[0] == '.') { return false; }
+    const size_t name_size = std::strlen(name);
+
+    // Шаблоны --glob сравниваются с путём относительно начальной директории. Шаблоны отбора не относятся
+    // к директориям: подходящие файлы могут находиться в любой из них.
+    const char* relative = path.c_str() + ignore.root_size;
+    const size_t relative_size = path.size() - ignore.root_size;
+    for (const Glob& glob : excludes)
+    {
+        if (glob.matches(relative, relative_size, name, name_size, directory)) { return false; }
+    }
+    if (!directory && !includes.empty())
+    {
+        bool included = false;
+        for (const Glob& glob : includes)
+        {
+            if (glob.matches(relative, relative_size, name, name_size, directory)) { included = true; break; }
+        }
+        if (!included) { return false; }
+    }
+
+    // Решение принимает последнее совпавшее правило ближайшей директории; '!' возвращает запись.
+    if (!options.ignore_files) { return true; }
+    std::string prefixed;
+    for (const Ignore* rules = &ignore; rules; rules = rules->parent.get())
+    {
+        const char* rules_relative = path.c_str() + rules->base_size;
+        size_t rules_relative_size = path.size() - rules->base_size;
+        for (auto glob = rules->globs.rbegin(); glob != rules->globs.rend(); ++glob)
+        {
+            // Для правил директорий выше начальной путь строится, только если шаблон сравнивается с путём.
+            if (!rules->prefix.empty() && glob->is_anchored() && prefixed.empty())
+            {
+                prefixed = rules->prefix;
+                prefixed.append(rules_relative, rules_relative_size);
+            }
+            const bool use_prefixed = !rules->prefix.empty() && glob->is_anchored();
+            if (glob->matches(use_prefixed ? prefixed.c_str() : rules_relative, use_prefixed ? prefixed.size() : rules_relative_size,
+                              name, name_size, directory))
+            { return glob->is_negated(); }
+        }
+        prefixed.clear();
+    }
+    return true;
+}
+
+bool Filter::is_binary(const char* begin, size_t size)
+{
+    return std::memchr(begin, '\0', size < binary_probe ? size : binary_probe) != nullptr;
+}
+
+// PROTECTED:
+void Filter::load(int descriptor, const char* name, std::vector<Glob>& globs)
+{
+    int file = openat(descriptor, name, O_RDONLY | O_CLOEXEC);
+    if (file < 0) { return; }
+    std::string text;
+    char buffer[4096];
+    while (true)
+    {
+        ssize_t count = read(file, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+        text.append(buffer, count);
+    }
+    close(file);
+
+    // Пустые строки и комментарии пропускаются, незащищённые конечные пробелы отбрасываются.
+    for (size_t begin = 0; begin < text.size();)
+    {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) { end = text.size(); }
+        std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) { line.pop_back(); }
+        if (line.empty() || line[0] == '#') { continue; }
+        if (line == "!" || line == "/") { continue; }
+        globs.emplace_back(line);
+    }
+}
+
+// PRIVATE:
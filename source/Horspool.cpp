@@ -0,0 +1,69 @@
+#include "Horspool.hpp"
+#include "CaseFold.hpp"
+#include <cstring>
+
+////////////////    Horspool    ////////////////
+// Класс, реализующий алгоритм Бойера-Мура-Хорспула.
+// PUBLIC:
+Horspool::Horspool(const std::string& init_string, bool init_case_insensitive)
+{
+    pattern = init_string;
+    case_insensitive = init_case_insensitive;
+    if (case_insensitive)
+    {
+        for (char& ch : pattern) { ch = CaseFold::fold_ascii(ch); }
+    }
+
+    // Сдвиг для байта - расстояние от его последнего вхождения (кроме последней позиции) до конца образца.
+    const size_t size = pattern.size();
+    shifts.fill(static_cast<uint32_t>(size));
+    for (size_t i = 0; i + 1 < size; ++i)
+    { shifts[static_cast<unsigned char>(pattern[i])] = static_cast<uint32_t>(size - 1 - i); }
+    if (case_insensitive)
+    {
+        for (size_t byte = 'A'; byte <= 'Z'; ++byte) { shifts[byte] = shifts[CaseFold::fold_ascii(byte)]; }
+    }
+}
+
+void Horspool::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    if (case_insensitive) { search_loop<true>(begin, end, entries); }
+    else { search_loop<false>(begin, end, entries); }
+}
+
+// PROTECTED:
+template <bool fold>
+void Horspool::search_loop(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    const size_t size = pattern.size();
+    if (!size || static_cast<size_t>(end - begin) < size) { return; }
+
+    LineTracker lines(begin, end, entries, limits);
+    const unsigned char last_byte = pattern[size - 1];
+    const char* last = end - size; // Последняя допустимая позиция начала вхождения.
+    for (const char* iter = begin; iter <= last;)
+    {
+        // Сначала сравнивается последний байт окна, затем - остальные.
+        const unsigned char byte = iter[size - 1];
+        if ((fold ? CaseFold::fold_ascii(byte) : byte) == last_byte)
+        {
+            bool equal = true;
+            if (fold)
+            {
+                for (size_t i = 0; equal && i + 1 < size; ++i)
+                { equal = (CaseFold::fold_ascii(iter[i]) == static_cast<unsigned char>(pattern[i])); }
+            }
+            else { equal = (std::memcmp(iter, pattern.data(), size - 1) == 0); }
+
+            if (equal)
+            {
+                lines.add(iter + size - 1);
+                if (lines.full()) { break; }
+            }
+        }
+        if (static_cast<size_t>(last - iter) < shifts[byte]) { break; }
+        iter += shifts[byte];
+    }
+}
+
+// PRIVATE:
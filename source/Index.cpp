@@ -0,0 +1,648 @@
+#include "Index.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FileView.hpp"
+#include "Filter.hpp"
+#include "Decompressor.hpp"
+
+// Сигнатура файла индекса.
+static const char index_magic[8] = {'P', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+// Добавление числа в кодировке varint (по 7 бит, старший бит - признак продолжения).
+static void append_varint(std::string& buffer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+// Декодирование списка номеров, записанного разностями в кодировке varint. Возвращает false, если
+// список повреждён: число не умещается в 32 бита, номера не возрастают или не меньше limit.
+static bool decode_postings(const unsigned char* begin, const unsigned char* end, uint32_t limit, std::vector<uint32_t>& values)
+{
+    uint64_t previous = 0;
+    while (begin < end)
+    {
+        uint64_t value = 0;
+        bool complete = false;
+        for (unsigned shift = 0; begin < end && shift < 35; shift += 7)
+        {
+            const unsigned char byte = *begin++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete || (!values.empty() && !value)) { return false; }
+        previous += value;
+        if (previous >= limit) { return false; }
+        values.push_back(static_cast<uint32_t>(previous));
+    }
+    return true;
+}
+
+// Время изменения файла в наносекундах.
+static int64_t modification_time(const struct stat& status)
+{
+    return static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+}
+
+// Лежит ли диапазон [offset, offset + size) внутри [0, limit) (без переполнения).
+static bool fits(uint64_t offset, uint64_t size, uint64_t limit)
+{
+    return offset <= limit && size <= limit - offset;
+}
+
+// Абсолютный путь без '.', '..' и конечного разделителя: так записываются пути индекса.
+static std::string normal_path(const std::filesystem::path& path)
+{
+    std::string text = std::filesystem::absolute(path).lexically_normal().native();
+    if (text.size() > 1 && text.back() == '/') { text.pop_back(); }
+    return text;
+}
+
+// Обход директории directory с правилами родительских директорий parent по тем же правилам фильтра,
+// что и при поиске без индекса: отфильтрованные записи пропускаются, отфильтрованные поддиректории не
+// читаются. Для каждой записи вызывается add_file, для директории (до чтения её содержимого) -
+// add_directory. Символические ссылки на директории не обходятся.
+static void walk_tree(const Filter& filter, const std::filesystem::path& directory, const std::shared_ptr<const Filter::Ignore>& parent,
+                      bool recursively, const std::function<void(const std::filesystem::path&)>& add_file,
+                      const std::function<void(const std::filesystem::path&)>& add_directory)
+{
+    add_directory(directory);
+    int descriptor = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (descriptor < 0) { return; }
+    const std::shared_ptr<const Filter::Ignore> ignore = filter.enter(directory.native(), descriptor, parent);
+    close(descriptor);
+
+    std::vector<std::filesystem::path> subdirectories;
+    std::error_code error;
+    for (auto iter = std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, error);
+         iter != std::filesystem::directory_iterator(); iter.increment(error))
+    {
+        if (error) { break; }
+        std::error_code type_error;
+        const bool is_directory = !iter->is_symlink(type_error) && iter->is_directory(type_error);
+        if (is_directory && !recursively) { continue; }
+        if (!filter.allows(iter->path().native(), iter->path().filename().c_str(), is_directory, *ignore)) { continue; }
+        if (is_directory) { subdirectories.push_back(iter->path()); }
+        else { add_file(iter->path()); }
+    }
+    for (const std::filesystem::path& subdirectory : subdirectories)
+    { walk_tree(filter, subdirectory, ignore, recursively, add_file, add_directory); }
+}
+
+// Правила файлов .gitignore и .ignore директории directory внутри дерева root (с правилами самой
+// директории), как их собирает обход от root.
+static std::shared_ptr<const Filter::Ignore> ignore_chain(const Filter& filter, const std::string& root, const std::string& directory)
+{
+    std::shared_ptr<const Filter::Ignore> ignore = filter.root(root);
+    for (size_t end = root.size();;)
+    {
+        const std::string current = directory.substr(0, std::max<size_t>(end, 1));
+        int descriptor = ::open(current.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (descriptor < 0) { break; }
+        ignore = filter.enter(current, descriptor, ignore);
+        close(descriptor);
+        if (end >= directory.size()) { break; }
+        end = std::min(directory.find('/', end + 1), directory.size());
+    }
+    return ignore;
+}
+
+////////////////     Index      ////////////////
+// Триграммный индекс дерева файлов.
+// PUBLIC:
+Index::~Index()
+{
+    if (data) { munmap(const_cast<char*>(data), data_size); }
+}
+
+bool Index::open(const std::filesystem::path& index_path)
+{
+    int descriptor = ::open(index_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) { return false; }
+
+    struct stat status;
+    void* address = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(Header))
+    { address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0); }
+    close(descriptor);
+    if (address == MAP_FAILED) { return false; }
+
+    data = static_cast<const char*>(address);
+    data_size = status.st_size;
+
+    // Проверка сигнатуры, версии, границ и выравнивания всех таблиц, а также границ каждого списка и
+    // каждого пути. Номера файлов в списках проверяются при декодировании.
+    const Header& head = header();
+    bool valid = !std::memcmp(head.magic, index_magic, sizeof(index_magic)) &&
+                 head.version == format_version && head.total_size == data_size &&
+                 head.files_offset >= sizeof(Header) && head.files_offset % alignof(FileRecord) == 0 &&
+                 head.directories_offset % alignof(DirectoryRecord) == 0 && head.trigrams_offset % alignof(TrigramRecord) == 0 &&
+                 head.files_number <= UINT32_MAX && head.files_number <= data_size / sizeof(FileRecord) &&
+                 head.directories_number <= data_size / sizeof(DirectoryRecord) && head.trigrams_number <= data_size / sizeof(TrigramRecord) &&
+                 fits(head.files_offset, head.files_number * sizeof(FileRecord), head.directories_offset) &&
+                 fits(head.directories_offset, head.directories_number * sizeof(DirectoryRecord), head.trigrams_offset) &&
+                 fits(head.trigrams_offset, head.trigrams_number * sizeof(TrigramRecord), head.postings_offset) &&
+                 head.postings_offset <= head.strings_offset && head.strings_offset <= data_size &&
+                 fits(0, head.root_length, data_size - head.strings_offset);
+    const uint64_t postings_size = head.postings_offset <= head.strings_offset ? head.strings_offset - head.postings_offset : 0;
+    const uint64_t strings_size = head.strings_offset <= data_size ? data_size - head.strings_offset : 0;
+    for (size_t file = 0; valid && file < head.files_number; ++file)
+    { valid = fits(files()[file].path_offset, files()[file].path_length, strings_size); }
+    for (size_t directory = 0; valid && directory < head.directories_number; ++directory)
+    { valid = fits(directories()[directory].path_offset, directories()[directory].path_length, strings_size); }
+    for (size_t i = 0; valid && i < head.trigrams_number; ++i)
+    {
+        valid = fits(trigrams()[i].postings_offset, trigrams()[i].postings_size, postings_size) &&
+                (!i || trigrams()[i - 1].trigram < trigrams()[i].trigram);
+    }
+    if (!valid)
+    {
+        munmap(address, data_size);
+        data = nullptr;
+        data_size = 0;
+    }
+    return valid;
+}
+
+std::filesystem::path Index::root() const
+{
+    return std::string(data + header().strings_offset, header().root_length);
+}
+
+size_t Index::files_number() const
+{
+    return header().files_number;
+}
+
+bool Index::covers(const std::filesystem::path& path) const
+{
+    const std::string scope = normal_path(path);
+    const std::string_view root_text = string(0, header().root_length);
+    return scope == root_text || (scope.size() > root_text.size() && scope.compare(0, root_text.size(), root_text) == 0 &&
+                                  (root_text.back() == '/' || scope[root_text.size()] == '/'));
+}
+
+std::vector<std::filesystem::path> Index::candidates(const std::vector<std::string>& literals, const std::filesystem::path& path,
+                                                      size_t threads_number, size_t& changed) const
+{
+    // Если хотя бы одна подстрока не ограничивает поиск, подходят все файлы.
+    const size_t number = files_number();
+    bool all = literals.empty();
+    for (const std::string& literal : literals) { all = all || literal.size() < 3; }
+
+    std::vector<char> selected(number, all);
+    if (!all)
+    {
+        for (const std::string& literal : literals)
+        {
+            for (uint32_t file : literal_candidates(literal)) { selected[file] = true; }
+        }
+        for (size_t file = 0; file < number; ++file)
+        {
+            if (files()[file].flags & unindexed) { selected[file] = true; }
+        }
+    }
+
+    // Рассматриваются только пути внутри scope; они выводятся в форме path, как при обходе path.
+    const std::filesystem::path display = path.empty() ? root() : path;
+    const std::string scope = normal_path(display);
+    auto inside = [&scope](std::string_view file) -> size_t
+    {
+        if (file == scope) { return file.size(); }
+        if (file.size() <= scope.size() || file.compare(0, scope.size(), scope)) { return 0; }
+        if (scope.back() == '/') { return scope.size(); }
+        return file[scope.size()] == '/' ? scope.size() + 1 : 0;
+    };
+    auto display_path = [&display, &scope](const std::string& file) -> std::filesystem::path
+    {
+        if (file.size() <= scope.size()) { return display; }
+        return display / file.substr(scope.size() + (scope.back() == '/' ? 0 : 1));
+    };
+
+    // Файлы с другими размером или временем изменения просматриваются полностью, удалённые пропускаются.
+    // Таблица файлов делится на части, которые проверяются в threads_number потоках. Файлы упорядочены по
+    // пути, поэтому файлы одной директории идут подряд: директория открывается один раз, и время
+    // изменения файла запрашивается относительно неё, без разбора полного пути.
+    enum : char { skipped = 0, matched = 1, modified = 2 };
+    std::vector<char> states(number, skipped);
+    std::atomic<size_t> next_part = 0;
+    auto check_files = [&]()
+    {
+        int descriptor = -1;
+        std::string_view opened;
+        std::string name;
+        for (size_t begin = next_part.fetch_add(check_part_size); begin < number; begin = next_part.fetch_add(check_part_size))
+        {
+            for (size_t file = begin; file < std::min(begin + check_part_size, number); ++file)
+            {
+                const FileRecord& record = files()[file];
+                const std::string_view file_text = string(record.path_offset, record.path_length);
+                if (!inside(file_text)) { continue; }
+
+                const size_t separator = file_text.rfind('/');
+                const std::string_view directory = file_text.substr(0, std::max<size_t>(separator, 1));
+                if (directory != opened || descriptor < 0)
+                {
+                    if (descriptor >= 0) { close(descriptor); }
+                    descriptor = ::open(std::string(directory).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                    opened = directory;
+                }
+                if (descriptor < 0) { continue; }
+                name.assign(file_text.substr(separator + 1));
+
+                struct stat status;
+                if (fstatat(descriptor, name.c_str(), &status, 0) || !S_ISREG(status.st_mode)) { continue; }
+                if (static_cast<uint64_t>(status.st_size) != record.size || modification_time(status) != record.mtime) { states[file] = modified; }
+                else if (selected[file]) { states[file] = matched; }
+            }
+        }
+        if (descriptor >= 0) { close(descriptor); }
+    };
+
+    // В директориях с другим временем изменения ищутся файлы, которых нет в индексе, с тем же фильтром,
+    // что и при построении. Новые поддиректории обходятся целиком, если индекс строился рекурсивно.
+    std::vector<std::filesystem::path> added;
+    std::mutex mutex_added;
+    const Filter filter{Filter::Options()};
+    const std::string root_text(string(0, header().root_length));
+    std::atomic<size_t> next_directory = 0;
+    auto check_directories = [&]()
+    {
+        std::vector<std::filesystem::path> local;
+        auto add_new = [this, &local, &inside](const std::filesystem::path& new_path)
+        {
+            struct stat status;
+            if (!inside(new_path.native()) || stat(new_path.c_str(), &status) || !S_ISREG(status.st_mode) || has_file(new_path.native())) { return; }
+            local.push_back(new_path);
+        };
+        for (size_t directory = next_directory++; directory < header().directories_number; directory = next_directory++)
+        {
+            const DirectoryRecord& record = directories()[directory];
+            const std::string directory_path(string(record.path_offset, record.path_length));
+            const bool above = directory_path.size() < scope.size() && !scope.compare(0, directory_path.size(), directory_path) &&
+                               (directory_path.back() == '/' || scope[directory_path.size()] == '/');
+            if (!above && !inside(directory_path)) { continue; }
+            struct stat status;
+            if (stat(directory_path.c_str(), &status) || !S_ISDIR(status.st_mode) || modification_time(status) == record.mtime) { continue; }
+
+            const std::shared_ptr<const Filter::Ignore> ignore = ignore_chain(filter, root_text, directory_path);
+            std::error_code error;
+            for (auto iter = std::filesystem::directory_iterator(directory_path, std::filesystem::directory_options::skip_permission_denied, error);
+                 iter != std::filesystem::directory_iterator(); iter.increment(error))
+            {
+                if (error) { break; }
+                std::error_code type_error;
+                const bool is_directory = !iter->is_symlink(type_error) && iter->is_directory(type_error);
+                if (is_directory && (!(record.flags & traversed) || has_directory(iter->path().native()))) { continue; }
+                if (!filter.allows(iter->path().native(), iter->path().filename().c_str(), is_directory, *ignore)) { continue; }
+                if (is_directory) { walk_tree(filter, iter->path(), ignore, true, add_new, [](const std::filesystem::path&) {}); }
+                else { add_new(iter->path()); }
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex_added);
+        added.insert(added.end(), local.begin(), local.end());
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::max<size_t>(threads_number, 1); ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            check_files();
+            check_directories();
+        });
+    }
+    check_files();
+    check_directories();
+    for (auto& thread : threads) { thread.join(); }
+
+    changed = added.size();
+    std::vector<std::filesystem::path> paths;
+    for (size_t file = 0; file < number; ++file)
+    {
+        if (states[file] == skipped) { continue; }
+        if (states[file] == modified) { ++changed; }
+        paths.push_back(display_path(file_path(file)));
+    }
+    std::sort(added.begin(), added.end());
+    for (const std::filesystem::path& new_path : added) { paths.push_back(display_path(new_path.native())); }
+    return paths;
+}
+
+size_t Index::build(const std::filesystem::path& index_path, const std::filesystem::path& root, bool recursively, size_t threads_number)
+{
+    // Перечисление обычных файлов дерева (символические ссылки на директории не обходятся).
+    struct Source
+    {
+        std::string path;
+        uint64_t size;
+        int64_t mtime;
+        uint32_t flags = 0;
+        bool fresh = true; // Файл требует чтения (новый или изменённый).
+    };
+    std::vector<Source> sources;
+    auto add_source = [&sources](const std::filesystem::path& path)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) || !S_ISREG(status.st_mode)) { return; }
+        sources.push_back(Source{path.string(), static_cast<uint64_t>(status.st_size), modification_time(status)});
+    };
+
+    // Директории записываются до чтения их содержимого: файл, добавленный позже, изменит время изменения
+    // директории и будет найден при поиске.
+    std::vector<std::pair<std::string, int64_t>> directory_sources;
+    auto add_directory = [&directory_sources](const std::filesystem::path& path)
+    {
+        struct stat status;
+        if (!stat(path.c_str(), &status)) { directory_sources.emplace_back(path.string(), modification_time(status)); }
+    };
+
+    // Файлы отбираются фильтром поиска по умолчанию (без скрытых файлов и файлов, исключённых правилами
+    // .gitignore и .ignore); при поиске по индексу другие правила обхода не допускаются.
+    const std::filesystem::path absolute_root = normal_path(root);
+    std::error_code error;
+    if (std::filesystem::is_directory(absolute_root, error))
+    {
+        const Filter filter{Filter::Options()};
+        walk_tree(filter, absolute_root, filter.root(absolute_root.native()), recursively, add_source, add_directory);
+    }
+    else { add_source(absolute_root); }
+    std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.path < b.path; });
+    std::sort(directory_sources.begin(), directory_sources.end());
+
+    // Списки номеров файлов для каждой триграммы. Списки неизменных файлов переносятся из прежнего
+    // индекса с переводом номеров.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> lists;
+    {
+        Index previous;
+        if (previous.open(index_path))
+        {
+            std::unordered_map<std::string, uint32_t> new_numbers;
+            for (size_t file = 0; file < sources.size(); ++file) { new_numbers.emplace(sources[file].path, file); }
+
+            std::vector<uint32_t> renumber(previous.files_number(), UINT32_MAX);
+            for (size_t file = 0; file < previous.files_number(); ++file)
+            {
+                const FileRecord& record = previous.files()[file];
+                auto found = new_numbers.find(previous.file_path(file));
+                if (found == new_numbers.end()) { continue; }
+                Source& source = sources[found->second];
+                if (source.size == record.size && source.mtime == record.mtime)
+                {
+                    renumber[file] = found->second;
+                    source.fresh = false;
+                    source.flags = record.flags;
+                }
+            }
+
+            // Если какой-либо список повреждён, прежний индекс не используется, и все файлы читаются заново.
+            std::vector<uint32_t> old_files;
+            for (size_t i = 0; i < previous.header().trigrams_number; ++i)
+            {
+                const TrigramRecord& record = previous.trigrams()[i];
+                old_files.clear();
+                const unsigned char* begin = reinterpret_cast<const unsigned char*>(previous.data + previous.header().postings_offset + record.postings_offset);
+                if (!decode_postings(begin, begin + record.postings_size, previous.files_number(), old_files))
+                {
+                    lists.clear();
+                    for (Source& source : sources)
+                    {
+                        source.fresh = true;
+                        source.flags = 0;
+                    }
+                    break;
+                }
+
+                std::vector<uint32_t>* list = nullptr;
+                for (uint32_t file : old_files)
+                {
+                    if (renumber[file] == UINT32_MAX) { continue; }
+                    if (!list) { list = &lists[record.trigram]; }
+                    list->push_back(renumber[file]);
+                }
+            }
+        }
+    }
+
+    // Чтение новых и изменённых файлов в несколько потоков. Каждый поток собирает свою часть списков,
+    // различные триграммы файла отмечаются в битовой карте на все 2^24 триграммы.
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> read_files = 0;
+    std::mutex mutex_lists;
+    auto index_files = [&]()
+    {
+        std::unordered_map<uint32_t, std::vector<uint32_t>> local_lists;
+        std::vector<uint64_t> seen((1 << 24) / 64, 0);
+        std::vector<uint32_t> file_trigrams;
+        for (size_t file = next++; file < sources.size(); file = next++)
+        {
+            Source& source = sources[file];
+            if (!source.fresh) { continue; }
+            ++read_files;
+
+            FileView view(source.path);
+            const unsigned char* begin = reinterpret_cast<const unsigned char*>(view.begin());
+            const size_t size = view.size();
+
+            // Двоичные и сжатые файлы не индексируются и проверяются при каждом поиске.
+            if (Filter::is_binary(view.begin(), size) || Decompressor::detect(view.begin(), size) != Decompressor::Format::none)
+            {
+                source.flags |= unindexed;
+                continue;
+            }
+
+            file_trigrams.clear();
+            for (size_t i = 2; i < size; ++i)
+            {
+                const uint32_t trigram = (static_cast<uint32_t>(begin[i - 2]) << 16) | (static_cast<uint32_t>(begin[i - 1]) << 8) | begin[i];
+                uint64_t& word = seen[trigram >> 6];
+                const uint64_t bit = static_cast<uint64_t>(1) << (trigram & 63);
+                if (!(word & bit))
+                {
+                    word |= bit;
+                    file_trigrams.push_back(trigram);
+                }
+            }
+            for (uint32_t trigram : file_trigrams)
+            {
+                seen[trigram >> 6] = 0;
+                local_lists[trigram].push_back(file);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_lists);
+        for (auto& [trigram, files] : local_lists)
+        {
+            std::vector<uint32_t>& list = lists[trigram];
+            list.insert(list.end(), files.begin(), files.end());
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::max<size_t>(threads_number, 1); ++i) { threads.emplace_back(index_files); }
+    index_files();
+    for (auto& thread : threads) { thread.join(); }
+
+    // Сериализация: заголовок, таблица файлов, таблица триграмм, списки, строки.
+    std::string strings = absolute_root.string();
+    std::vector<FileRecord> file_records;
+    for (const Source& source : sources)
+    {
+        file_records.push_back(FileRecord{strings.size(), static_cast<uint32_t>(source.path.size()), source.flags, source.size, source.mtime});
+        strings += source.path;
+    }
+    std::vector<DirectoryRecord> directory_records;
+    for (const auto& [path, mtime] : directory_sources)
+    {
+        directory_records.push_back(DirectoryRecord{strings.size(), static_cast<uint32_t>(path.size()), recursively ? traversed : 0, mtime});
+        strings += path;
+    }
+
+    std::vector<uint32_t> trigram_keys;
+    for (const auto& list : lists) { trigram_keys.push_back(list.first); }
+    std::sort(trigram_keys.begin(), trigram_keys.end());
+
+    std::vector<TrigramRecord> trigram_records;
+    std::string postings;
+    for (uint32_t trigram : trigram_keys)
+    {
+        std::vector<uint32_t>& list = lists[trigram];
+        std::sort(list.begin(), list.end());
+        const size_t offset = postings.size();
+        uint32_t previous = 0;
+        for (uint32_t file : list)
+        {
+            append_varint(postings, file - previous);
+            previous = file;
+        }
+        trigram_records.push_back(TrigramRecord{trigram, static_cast<uint32_t>(postings.size() - offset), offset});
+    }
+
+    Header head = {};
+    std::memcpy(head.magic, index_magic, sizeof(index_magic));
+    head.version = format_version;
+    head.root_length = absolute_root.string().size();
+    head.files_number = file_records.size();
+    head.trigrams_number = trigram_records.size();
+    head.directories_number = directory_records.size();
+    head.files_offset = sizeof(Header);
+    head.directories_offset = head.files_offset + file_records.size() * sizeof(FileRecord);
+    head.trigrams_offset = head.directories_offset + directory_records.size() * sizeof(DirectoryRecord);
+    head.postings_offset = head.trigrams_offset + trigram_records.size() * sizeof(TrigramRecord);
+    head.strings_offset = head.postings_offset + postings.size();
+    head.total_size = head.strings_offset + strings.size();
+
+    // Индекс записывается во временный файл и заменяет прежний атомарно.
+    std::filesystem::path temporary_path = index_path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(&head), sizeof(head));
+        stream.write(reinterpret_cast<const char*>(file_records.data()), file_records.size() * sizeof(FileRecord));
+        stream.write(reinterpret_cast<const char*>(directory_records.data()), directory_records.size() * sizeof(DirectoryRecord));
+        stream.write(reinterpret_cast<const char*>(trigram_records.data()), trigram_records.size() * sizeof(TrigramRecord));
+        stream.write(postings.data(), postings.size());
+        stream.write(strings.data(), strings.size());
+        if (!stream) { throw std::filesystem::filesystem_error("не удалось записать индекс", temporary_path, std::make_error_code(std::errc::io_error)); }
+    }
+    std::filesystem::rename(temporary_path, index_path);
+
+    return read_files;
+}
+
+// PROTECTED:
+std::string Index::file_path(uint32_t file) const
+{
+    const FileRecord& record = files()[file];
+    return std::string(string(record.path_offset, record.path_length));
+}
+
+bool Index::has_file(std::string_view path) const
+{
+    const FileRecord* begin = files();
+    const FileRecord* end = begin + header().files_number;
+    const FileRecord* found = std::lower_bound(begin, end, path,
+        [this](const FileRecord& record, std::string_view value) { return string(record.path_offset, record.path_length) < value; });
+    return found != end && string(found->path_offset, found->path_length) == path;
+}
+
+bool Index::has_directory(std::string_view path) const
+{
+    const DirectoryRecord* begin = directories();
+    const DirectoryRecord* end = begin + header().directories_number;
+    const DirectoryRecord* found = std::lower_bound(begin, end, path,
+        [this](const DirectoryRecord& record, std::string_view value) { return string(record.path_offset, record.path_length) < value; });
+    return found != end && string(found->path_offset, found->path_length) == path;
+}
+
+std::vector<uint32_t> Index::postings(uint32_t trigram) const
+{
+    std::vector<uint32_t> values;
+    const TrigramRecord* begin = trigrams();
+    const TrigramRecord* end = begin + header().trigrams_number;
+    const TrigramRecord* found = std::lower_bound(begin, end, trigram,
+        [](const TrigramRecord& record, uint32_t value) { return record.trigram < value; });
+    if (found == end || found->trigram != trigram) { return values; }
+
+    // Повреждённый список не ограничивает поиск: подходят все файлы.
+    const unsigned char* list = reinterpret_cast<const unsigned char*>(data + header().postings_offset + found->postings_offset);
+    if (!decode_postings(list, list + found->postings_size, files_number(), values))
+    {
+        values.resize(files_number());
+        for (size_t file = 0; file < values.size(); ++file) { values[file] = file; }
+    }
+    return values;
+}
+
+std::vector<uint32_t> Index::literal_candidates(const std::string& literal) const
+{
+    // Различные триграммы подстроки.
+    std::vector<uint32_t> literal_trigrams;
+    for (size_t i = 2; i < literal.size(); ++i)
+    {
+        literal_trigrams.push_back((static_cast<uint32_t>(static_cast<unsigned char>(literal[i - 2])) << 16) |
+                                   (static_cast<uint32_t>(static_cast<unsigned char>(literal[i - 1])) << 8) |
+                                   static_cast<unsigned char>(literal[i]));
+    }
+    std::sort(literal_trigrams.begin(), literal_trigrams.end());
+    literal_trigrams.erase(std::unique(literal_trigrams.begin(), literal_trigrams.end()), literal_trigrams.end());
+
+    // Пересечение списков, начиная с самых коротких.
+    std::vector<std::vector<uint32_t>> lists;
+    for (uint32_t trigram : literal_trigrams)
+    {
+        lists.push_back(postings(trigram));
+        if (lists.back().empty()) { return {}; }
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+    std::vector<uint32_t> result = std::move(lists.front());
+    std::vector<uint32_t> intersection;
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i)
+    {
+        intersection.clear();
+        std::set_intersection(result.begin(), result.end(), lists[i].begin(), lists[i].end(), std::back_inserter(intersection));
+        result.swap(intersection);
+    }
+    return result;
+}
+
+// PRIVATE:
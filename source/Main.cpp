@@ -6,10 +6,26 @@
 #include <string>
 #include <vector>
 #include <exception>
-//#include <chrono>
+#include <fstream>
+#include <chrono>
+#include <ctime>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unistd.h>
 
 #include "Searcher.hpp"
 #include "Walker.hpp"
+#include "Stats.hpp"
+#include "Index.hpp"
+#include "Server.hpp"
+#include "ResultCache.hpp"
+#include "Engine.hpp"
+#include "Filter.hpp"
+#include "Search.hpp"
+#include "Cpu.hpp"
 
 class invalid_arguments : std::exception
 {
@@ -71,14 +87,90 @@ const std::string help_text  =
 --help, -h                    Показать справку.
 <pattern> <keys>              Поиск подстроки pattern в текущей директории с ключами keys.
 <pattern> <keys> <path>       Поиск подстроки pattern в директории path с ключами keys.
+-f <file> <keys> <path>       Одновременный поиск всех образцов из файла file (по одному в строке).
+--server <socket> <keys> <path>
+                              Запустить сервер поиска в директории path, принимающий запросы через
+                              Unix domain socket (допустимы ключи -t и -n). Список файлов хранится
+                              в памяти и обновляется по событиям inotify; файлы отбираются, как при
+                              поиске без сервера. Пути выводятся относительно path.
+--index-build <index> <keys> <path>
+                              Построить триграммный индекс директории path в файле index (допустимы
+                              ключи -t и -n). Если индекс уже существует, заново читаются только
+                              новые и изменённые (по размеру и времени изменения) файлы.
 
 Ключи:
--t<n>                         Запустить поиск в n потоков.
+-t<n>                         Запустить поиск в n потоков. -tauto (по умолчанию): число потоков
+                              подбирается во время поиска - от числа доступных ядер (с учётом маски
+                              привязки и квоты cgroup) до вдвое большего, пока потоки ждут чтения.
+--pin                         Привязать потоки поиска к ядрам (сначала по одному на физическое ядро).
 -n                            Нерекурсивный поиск.
 -b                            Запустить программу в режиме измерения времени.
+-e<engine>                    Использовать алгоритм поиска engine: auto (по умолчанию, выбор по длине
+                              и байтам образца), kmp, simd, horspool или twoway.
+--check=<engine>              Самопроверка: искать также алгоритмом engine и аварийно завершаться
+                              при расхождении результатов.
+-E                            Интерпретировать pattern как регулярное выражение.
+-i                            Искать без учёта регистра (латиница, кириллица, греческий, армянский).
+-s<size>                      Делить файлы больше size байт (допустимы суффиксы K, M, G) на части для
+                              поиска в разных потоках; -s0 отключает деление. По умолчанию 64M.
+--sort                        Выводить вхождения по завершении поиска, упорядочив файлы по пути.
+-l                            Выводить только пути файлов с вхождениями (поиск в файле прекращается
+                              на первом вхождении).
+-c                            Выводить пути файлов с вхождениями и число строк с вхождениями.
+-m<n>                         Прекращать поиск в файле после n строк с вхождениями.
+--limit=<n>                   Прекратить поиск после вывода n строк (с -l и -c - n файлов).
+--stats                       Вывести в stderr статистику поиска в формате JSON.
+--progress                    Выводить в stderr снимки прогресса поиска раз в секунду.
+--index=<index>               Искать только в файлах из индекса index, которые могут содержать образец.
+                              Путь поиска должен лежать внутри директории индекса; без пути поиск
+                              выполняется во всей директории индекса.
+--cache=<file>                Хранить результаты поиска в файле file и не просматривать повторно файлы
+                              с неизменными размером и временем изменения. Файл, доступный по
+                              нескольким жёстким ссылкам, обрабатывается и выводится один раз.
+                              Записи, не использованные за 16 сохранений кэша подряд, удаляются.
+--glob=<glob>                 Искать только в файлах, подходящих под шаблон glob (синтаксис .gitignore;
+                              шаблон без '/' сравнивается с именем, остальные - с путём относительно
+                              директории поиска). Шаблон с префиксом '!' исключает файлы и директории.
+                              Ключ можно передать несколько раз.
+--no-ignore                   Не учитывать правила файлов .gitignore и .ignore.
+--hidden                      Искать в скрытых файлах и директориях (имя начинается с точки).
+--follow                      Обходить директории по символическим ссылкам.
+--binary                      Искать в двоичных файлах (с нулевым байтом в первых 8K). По умолчанию
+                              такие файлы пропускаются.
+--max-size=<size>             Пропускать файлы больше size байт (допустимы суффиксы K, M, G).
+--no-decompress               Не распаковывать файлы gzip и zstd. По умолчанию сжатые файлы (по
+                              сигнатуре) распаковываются потоком; номера строк выводятся в
+                              распакованном содержимом.
+--io=<mode>                   Способ чтения файлов: auto (по умолчанию: uring, если ядро поддерживает
+                              io_uring, иначе threads), uring (асинхронное чтение через io_uring),
+                              threads (posix_fadvise и пул потоков чтения) или mmap (отображение в
+                              память без упреждающего чтения). Буфферы чтения всех потоков занимают
+                              не больше 64M; файлы больше четверти доли потока отображаются в память.
+--client=<socket>             Передать запрос серверу, запущенному с --server <socket>. Допустимы
+                              ключи -f, -e, -E, -i, -s, -l, -c, -m, --limit и --sort.
+
+По умолчанию скрытые файлы и директории, файлы, исключённые правилами .gitignore и .ignore, и двоичные
+файлы пропускаются, а сжатые файлы распаковываются (так же отбирают файлы --index-build и --server).
+Прежде просматривались все файлы как есть; прежнее поведение: --hidden --no-ignore --binary --no-decompress.
 )";
 
 
+// Перевод размера с необязательным суффиксом K, M или G в число байт.
+uintmax_t parse_size(const std::string& text)
+{
+    size_t position = 0;
+    uintmax_t size = std::stoull(text, &position);
+    if (position == text.size()) { return size; }
+    if (position + 1 != text.size()) { throw std::invalid_argument(text); }
+    switch (text[position])
+    {
+        case 'K': { return size << 10; }
+        case 'M': { return size << 20; }
+        case 'G': { return size << 30; }
+        default: { throw std::invalid_argument(text); }
+    }
+}
+
 int main(int argc, char* argv[])
 {
     int threads_number = -1;
@@ -86,6 +178,28 @@ int main(int argc, char* argv[])
     std::string pattern;
     std::string path_str;
     bool benchmark = false;
+    std::string engine;
+    std::string check_engine;
+    std::string patterns_file;
+    bool regex = false;
+    bool case_insensitive = false;
+    bool pin = false;
+    Walker::Options walker_options;
+    walker_options.decompress = true;
+    Filter::Options filter_options;
+    bool filter_keys = false;
+    std::string io_mode;
+    bool chunk_size_set = false;
+    bool sorted = false;
+    bool stats_requested = false;
+    bool progress = false;
+    std::string index_build_file;
+    std::string index_file;
+    std::string server_socket;
+    std::string client_socket;
+    std::string cache_file;
+    Output::Mode output_mode = Output::Mode::lines;
+    Searcher::Limits limits;
 
     try
     {
@@ -102,10 +216,35 @@ int main(int argc, char* argv[])
             }
         }
 
-        pattern = std::string(argv[1]);
+        // Образцы могут быть заданы файлом вместо единственного образца; в режиме построения индекса
+        // образец не задаётся.
+        int first_key = 2;
+        if (std::string(argv[1]) == "--server")
+        {
+            if (argc < 3) { throw invalid_arguments(invalid_arguments::code::missing, "--server <socket> (путь к сокету)."); }
+            server_socket = std::string(argv[2]);
+            first_key = 3;
+        }
+        else if (std::string(argv[1]) == "--index-build")
+        {
+            if (argc < 3) { throw invalid_arguments(invalid_arguments::code::missing, "--index-build <index> (файл индекса)."); }
+            index_build_file = std::string(argv[2]);
+            first_key = 3;
+        }
+        else if (std::string(argv[1]) == "-f")
+        {
+            if (argc < 3) { throw invalid_arguments(invalid_arguments::code::missing, "-f <file> (файл с образцами)."); }
+            patterns_file = std::string(argv[2]);
+            first_key = 3;
+        }
+        else
+        {
+            pattern = std::string(argv[1]);
+            if (pattern.empty()) { throw invalid_arguments(invalid_arguments::code::invalid, "pattern (образец не может быть пустым)."); }
+        }
 
         // Получение дополнительных аргументов.
-        for (int arg_i = 2; arg_i < argc; ++arg_i)
+        for (int arg_i = first_key; arg_i < argc; ++arg_i)
         {
             std::string argument(argv[arg_i]);
 
@@ -116,18 +255,23 @@ int main(int argc, char* argv[])
                 if (argument[1] == 't')
                 {
                     // Если число потоков уже задано, выброс исключения.
-                    if (threads_number > 0)
+                    if (threads_number >= 0)
                     { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (число потоков уже было передано в качестве аргумента)."); }
 
-                    // Перевод значения ключа в число. При неудаче - выброс исключения.
-                    try
-                    { threads_number = std::stoi(argument.substr(2, argument.size() - 1)); }
-                    catch (const std::logic_error& eception)
-                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось число)."); }
+                    // -tauto - подбор числа потоков (threads_number = 0).
+                    if (argument == "-tauto") { threads_number = 0; }
+                    else
+                    {
+                        // Перевод значения ключа в число. При неудаче - выброс исключения.
+                        try
+                        { threads_number = std::stoi(argument.substr(2, argument.size() - 1)); }
+                        catch (const std::logic_error& eception)
+                        { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось число)."); }
 
-                    // Если число потоков некорректно, выброс исключения.
-                    if (threads_number < 1)
-                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (число потоков строго положительно)."); }
+                        // Если число потоков некорректно, выброс исключения.
+                        if (threads_number < 1)
+                        { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (число потоков строго положительно)."); }
+                    }
                 }
                 // Ключ нерекурсивного поиска.
                 else if (argument == "-n")
@@ -145,6 +289,201 @@ int main(int argc, char* argv[])
                     else
                     { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ измерения времени выполнения уже был передан в качестве аргумента)"); }
                 }
+                // Ключ размера частей, на которые делятся большие файлы.
+                else if (argument[1] == 's')
+                {
+                    if (chunk_size_set)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (размер частей уже был передан в качестве аргумента)."); }
+
+                    try
+                    { walker_options.chunk_size = parse_size(argument.substr(2)); }
+                    catch (const std::logic_error& exception)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался размер)."); }
+                    chunk_size_set = true;
+                }
+                // Ключ выбора алгоритма поиска.
+                else if (argument[1] == 'e')
+                {
+                    if (!patterns_file.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (для поиска образцов из файла используется автомат Ахо-Корасик)."); }
+                    if (regex)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (для регулярных выражений используется ленивый ДКА)."); }
+                    if (!engine.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (алгоритм поиска уже был передан в качестве аргумента)."); }
+
+                    engine = argument.substr(2);
+                    const std::vector<std::string>& names = Engine::single_pattern_engines();
+                    if (std::find(names.begin(), names.end(), engine) == names.end())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось auto, kmp, simd, horspool или twoway)."); }
+                }
+                // Ключ самопроверки.
+                else if (argument.compare(0, 8, "--check=") == 0)
+                {
+                    if (!check_engine.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (алгоритм самопроверки уже был передан в качестве аргумента)."); }
+                    check_engine = argument.substr(8);
+                    const std::vector<std::string>& names = Engine::single_pattern_engines();
+                    if (std::find(names.begin(), names.end(), check_engine) == names.end())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось auto, kmp, simd, horspool или twoway)."); }
+                }
+                // Ключ упорядоченного вывода.
+                else if (argument == "--sort")
+                {
+                    if (sorted)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ упорядоченного вывода уже был передан в качестве аргумента)."); }
+                    sorted = true;
+                }
+                // Ключи вывода только файлов или числа строк.
+                else if (argument == "-l" || argument == "-c")
+                {
+                    if (output_mode != Output::Mode::lines)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (формат вывода уже был передан в качестве аргумента)."); }
+                    output_mode = (argument == "-l") ? Output::Mode::files : Output::Mode::counts;
+                }
+                // Ключ ограничения числа строк в файле.
+                else if (argument[1] == 'm')
+                {
+                    if (limits.max_lines)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ограничение числа строк уже было передано в качестве аргумента)."); }
+
+                    try
+                    { limits.max_lines = std::stoull(argument.substr(2)); }
+                    catch (const std::logic_error& exception)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось число)."); }
+
+                    if (!limits.max_lines)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (число строк строго положительно)."); }
+                }
+                // Ключ общего ограничения числа результатов.
+                else if (argument.compare(0, 8, "--limit=") == 0)
+                {
+                    if (walker_options.max_results)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ограничение числа результатов уже было передано в качестве аргумента)."); }
+
+                    try
+                    { walker_options.max_results = std::stoull(argument.substr(8)); }
+                    catch (const std::logic_error& exception)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось число)."); }
+
+                    if (!walker_options.max_results)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (число результатов строго положительно)."); }
+                }
+                // Ключи вывода статистики и прогресса.
+                else if (argument == "--stats" || argument == "--progress")
+                {
+                    #ifndef PSEARCH_ENABLE_STATS
+                    throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (программа собрана без сбора статистики, PSEARCH_STATS=OFF).");
+                    #endif
+                    bool& flag = (argument == "--stats") ? stats_requested : progress;
+                    if (flag)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ уже был передан в качестве аргумента)."); }
+                    flag = true;
+                }
+                // Ключ поиска по индексу.
+                else if (argument.compare(0, 8, "--index=") == 0)
+                {
+                    if (!index_file.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (индекс уже был передан в качестве аргумента)."); }
+                    index_file = argument.substr(8);
+                    if (index_file.empty())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался путь к индексу)."); }
+                }
+                // Ключ кэша результатов.
+                else if (argument.compare(0, 8, "--cache=") == 0)
+                {
+                    if (!cache_file.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (кэш уже был передан в качестве аргумента)."); }
+                    cache_file = argument.substr(8);
+                    if (cache_file.empty())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался путь к файлу кэша)."); }
+                }
+                // Ключ передачи запроса серверу.
+                else if (argument.compare(0, 9, "--client=") == 0)
+                {
+                    if (!client_socket.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (сервер уже был передан в качестве аргумента)."); }
+                    client_socket = argument.substr(9);
+                    if (client_socket.empty())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался путь к сокету)."); }
+                }
+                // Ключ поиска без учёта регистра.
+                else if (argument == "-i")
+                {
+                    if (case_insensitive)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ поиска без учёта регистра уже был передан в качестве аргумента)."); }
+                    case_insensitive = true;
+                }
+                // Ключ шаблона отбора файлов (может передаваться несколько раз).
+                else if (argument.compare(0, 7, "--glob=") == 0)
+                {
+                    const std::string glob = argument.substr(7);
+                    if (glob.empty() || glob == "!")
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался шаблон)."); }
+                    filter_options.globs.push_back(glob);
+                    filter_keys = true;
+                }
+                // Ключи политики обхода.
+                else if (argument == "--no-ignore" || argument == "--hidden" || argument == "--follow" || argument == "--binary")
+                {
+                    bool& flag = (argument == "--no-ignore") ? filter_options.ignore_files :
+                                 (argument == "--hidden") ? filter_options.hidden :
+                                 (argument == "--follow") ? filter_options.follow_links : filter_options.binary;
+                    const bool value = (argument != "--no-ignore");
+                    if (flag == value)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ уже был передан в качестве аргумента)."); }
+                    flag = value;
+                    filter_keys = true;
+                }
+                // Ключ привязки потоков к ядрам.
+                else if (argument == "--pin")
+                {
+                    if (pin)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ уже был передан в качестве аргумента)."); }
+                    pin = true;
+                }
+                // Ключ отказа от распаковки сжатых файлов.
+                else if (argument == "--no-decompress")
+                {
+                    if (!walker_options.decompress)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ уже был передан в качестве аргумента)."); }
+                    walker_options.decompress = false;
+                    filter_keys = true;
+                }
+                // Ключ ограничения размера файлов.
+                else if (argument.compare(0, 11, "--max-size=") == 0)
+                {
+                    if (filter_options.max_size)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ограничение размера уже было передано в качестве аргумента)."); }
+
+                    try
+                    { filter_options.max_size = parse_size(argument.substr(11)); }
+                    catch (const std::logic_error& exception)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидался размер)."); }
+
+                    if (!filter_options.max_size)
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (размер строго положителен)."); }
+                    filter_keys = true;
+                }
+                // Ключ способа чтения файлов.
+                else if (argument.compare(0, 5, "--io=") == 0)
+                {
+                    if (!io_mode.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (способ чтения уже был передан в качестве аргумента)."); }
+                    io_mode = argument.substr(5);
+                    if (io_mode != "auto" && io_mode != "uring" && io_mode != "threads" && io_mode != "mmap")
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ожидалось auto, uring, threads или mmap)."); }
+                    if (io_mode == "uring" && !Reader::uring_supported())
+                    { throw invalid_arguments(invalid_arguments::code::invalid, argument + " (ядро не поддерживает io_uring)."); }
+                }
+                // Ключ поиска по регулярному выражению.
+                else if (argument == "-E")
+                {
+                    if (regex)
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (ключ поиска по регулярному выражению уже был передан в качестве аргумента)."); }
+                    if (!patterns_file.empty() || !engine.empty())
+                    { throw invalid_arguments(invalid_arguments::code::incompatable, argument + " (регулярное выражение несовместимо с -f и -e)."); }
+                    regex = true;
+                }
                 else
                 { throw invalid_arguments(invalid_arguments::code::unknown, argument); }
             }
@@ -156,6 +495,25 @@ int main(int argc, char* argv[])
                 path_str = argument;
             }
         }
+
+        // Проверка совместимости режимов работы с индексом. query_keys - ключи, уточняющие запрос поиска.
+        const bool query_keys = output_mode != Output::Mode::lines || limits.max_lines || walker_options.max_results || case_insensitive || !check_engine.empty() || filter_keys || !io_mode.empty() || pin;
+        if (!index_build_file.empty() && (regex || !engine.empty() || sorted || stats_requested || progress || chunk_size_set || benchmark || !index_file.empty() || query_keys))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--index-build (допустимы только ключи -t и -n)."); }
+        if (!cache_file.empty() && (!index_build_file.empty() || !server_socket.empty() || !client_socket.empty()))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--cache (кэш используется только при обычном поиске)."); }
+        if (!server_socket.empty() && (regex || !engine.empty() || sorted || stats_requested || progress || chunk_size_set || benchmark || !index_file.empty() || !client_socket.empty() || query_keys))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--server (допустимы только ключи -t и -n)."); }
+        if (!client_socket.empty() && (!path_str.empty() || !recursively || threads_number >= 0 || pin || stats_requested || progress || benchmark || !index_file.empty()))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--client (директория и число потоков задаются сервером)."); }
+        if (!check_engine.empty() && (!patterns_file.empty() || regex || !client_socket.empty()))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--check (самопроверка выполняется для одного образца при обычном поиске)."); }
+        if (!index_file.empty() && !recursively)
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--index (глубина обхода задаётся индексом)."); }
+        if ((filter_keys || !io_mode.empty()) && !client_socket.empty())
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--client (фильтры обхода и способ чтения задаются только при обычном поиске)."); }
+        if (!index_file.empty() && (!filter_options.globs.empty() || !filter_options.ignore_files || filter_options.hidden || filter_options.follow_links))
+        { throw invalid_arguments(invalid_arguments::code::incompatable, "--index (при поиске по индексу применяются только --max-size и --binary)."); }
     }
     catch (const invalid_arguments &exception)
     {
@@ -163,51 +521,262 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    // Обработка ситуации, когда число потоков передано не было.
-    if (threads_number < 0) { threads_number = 1; }
+    // Если число потоков не передано или передано -tauto, при поиске запускается вдвое больше потоков, чем
+    // доступно ядер, а активными остаются от числа ядер до всех (Walker::Options::adaptive). Сервер и
+    // построение индекса используют число доступных ядер.
+    if (threads_number <= 0)
+    {
+        const size_t available = Cpu::available();
+        const bool searching = server_socket.empty() && index_build_file.empty();
+        threads_number = searching ? 2 * available : available;
+        walker_options.adaptive = searching;
+        walker_options.active_threads = available;
+    }
+    if (pin) { walker_options.cores = Cpu::cores(); }
+
+    // Режим сервера.
+    if (!server_socket.empty())
+    {
+        std::filesystem::path root = path_str.empty() ? std::filesystem::current_path() : std::filesystem::path(path_str);
+        std::error_code error;
+        if (!std::filesystem::is_directory(root, error))
+        {
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, path_str + " (ожидалась директория).").what() << std::endl;
+            return 1;
+        }
+
+        // Список файлов и поиск по запросам используют фильтр обхода и распаковку по умолчанию, как и
+        // поиск без сервера.
+        walker_options.filter = std::make_shared<const Filter>(filter_options);
+        Server server(root, recursively, threads_number, walker_options);
+        if (!server.serve(server_socket))
+        {
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, "--server " + server_socket + " (не удалось создать сокет).").what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Построение индекса.
+    if (!index_build_file.empty())
+    {
+        std::filesystem::path root = path_str.empty() ? std::filesystem::current_path() : std::filesystem::path(path_str);
+        std::error_code error;
+        if (!std::filesystem::exists(root, error))
+        {
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, path_str + " (путь не существует).").what() << std::endl;
+            return 1;
+        }
+
+        try
+        {
+            size_t read_files = Index::build(index_build_file, root, recursively, threads_number);
+            std::cout << "Индекс построен, прочитано файлов: " << read_files << std::endl;
+        }
+        catch (const std::filesystem::filesystem_error& exception)
+        {
+            std::cerr << exception.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
     // Измерение времени выполнения.
+    auto wall_started = std::chrono::steady_clock::now();
     std::clock_t timestamp_started = std::clock();
 
-    // Создание КМП-автомата для образца.
-    std::shared_ptr<KMP> kmp(new KMP(pattern));
+    // Параметры поиска. Образцы из файла читаются до создания объекта поиска.
+    std::vector<std::string> patterns;
+    if (!patterns_file.empty())
+    {
+        std::ifstream patterns_stream(patterns_file);
+        if (!patterns_stream)
+        {
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, "-f " + patterns_file + " (не удалось открыть файл).").what() << std::endl;
+            return 1;
+        }
+
+        // Пустые строки пропускаются, завершающий символ возврата каретки отбрасывается.
+        for (std::string line; std::getline(patterns_stream, line);)
+        {
+            if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+            if (!line.empty()) { patterns.push_back(line); }
+        }
+        if (patterns.empty())
+        {
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, "-f " + patterns_file + " (файл не содержит образцов).").what() << std::endl;
+            return 1;
+        }
+    }
 
-    // Создание объекта для поиска.
-    Walker walker(kmp);
+    Search::Options search_options;
+    search_options.query.pattern = pattern;
+    search_options.query.patterns = patterns;
+    search_options.query.engine = engine;
+    search_options.query.regex = regex;
+    search_options.query.case_insensitive = case_insensitive;
+    search_options.check_engine = check_engine;
+    search_options.mode = output_mode;
+    search_options.max_lines = limits.max_lines;
+    search_options.threads_number = threads_number;
+    search_options.recursively = recursively;
+    const std::string engine_name = Engine::choose(search_options.query);
 
-    // Выбор директории для поиска.
+    // При выводе только файлов поиск в файле прекращается на первой строке с вхождением.
+    if (output_mode == Output::Mode::files) { limits.max_lines = 1; }
+    limits.copy_lines = (output_mode == Output::Mode::lines);
+
+    // Объект поиска создаётся после задания всех параметров. Ошибки в образце сообщаются до проверки пути.
+    std::unique_ptr<Search> search;
+    auto create_search = [&]()
+    {
+        try
+        { search = std::make_unique<Search>(search_options); }
+        catch (const std::logic_error& exception)
+        {
+            const std::string source = patterns_file.empty() ? pattern : "-f " + patterns_file;
+            std::cerr << invalid_arguments(invalid_arguments::code::invalid, source + " (" + exception.what() + ").").what() << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    // Передача запроса серверу. Объект для поиска создаётся и на клиенте, чтобы ошибки в образце
+    // обнаруживались до подключения.
+    if (!client_socket.empty())
+    {
+        if (!create_search()) { return 1; }
+        Server::Request request;
+        request.pattern = pattern;
+        request.patterns = patterns;
+        request.engine = engine;
+        request.regex = regex;
+        request.case_insensitive = case_insensitive;
+        request.sorted = sorted;
+        request.chunk_size = walker_options.chunk_size;
+        request.mode = output_mode;
+        request.max_lines = limits.max_lines;
+        request.max_results = walker_options.max_results;
+        return Server::query(client_socket, request, STDOUT_FILENO);
+    }
+
+    // Сбор статистики.
+    std::shared_ptr<Stats> stats;
+    if (stats_requested || progress)
+    {
+        stats = std::make_shared<Stats>(threads_number, engine_name);
+        walker_options.stats = stats;
+    }
+
+    // Кэш результатов. Сигнатура запроса включает алгоритм, образцы и их вид (литерал или регулярное
+    // выражение: оба ищутся ленивым ДКА при -i с символами вне ASCII), ограничения поиска в файле, поиск
+    // в двоичных файлах и распаковку сжатых.
+    std::shared_ptr<ResultCache> cache;
+    if (!cache_file.empty())
+    {
+        std::string signature = engine_name;
+        signature.push_back('\0');
+        signature += pattern;
+        for (const std::string& item : patterns) { signature.push_back('\0'); signature += item; }
+        signature.push_back('\0');
+        signature += std::to_string(limits.max_lines) + (limits.copy_lines ? ":lines" : "") + (case_insensitive ? ":i" : "") + (regex ? ":E" : "") +
+                     (filter_options.binary ? ":binary" : "") + (walker_options.decompress ? ":z" : "");
+        cache = std::make_shared<ResultCache>(cache_file, signature);
+        walker_options.cache = cache;
+    }
+
+    // Фильтр обхода: скрытые файлы, шаблоны, правила .gitignore и .ignore, размер и двоичные файлы.
+    walker_options.filter = std::make_shared<const Filter>(filter_options);
+
+    // Способ чтения файлов.
+    if (io_mode.empty() || io_mode == "auto") { io_mode = Reader::uring_supported() ? "uring" : "threads"; }
+    walker_options.read_backend = (io_mode == "uring") ? Reader::Backend::uring :
+                                  (io_mode == "threads") ? Reader::Backend::threads : Reader::Backend::none;
+
+    search_options.walker = walker_options;
+    if (!create_search()) { return 1; }
+
+    // При поиске по индексу проверяются только файлы, содержащие все триграммы образца.
+    Index index;
+    if (!index_file.empty() && !index.open(index_file))
+    {
+        std::cerr << invalid_arguments(invalid_arguments::code::invalid, "--index=" + index_file + " (не удалось открыть индекс).").what() << std::endl;
+        return 1;
+    }
+
+    // Выбор директории для поиска. Без пути поиск по индексу выполняется в директории индекса.
     std::filesystem::path search_path;
     if (!path_str.empty())
     { search_path = std::filesystem::path(path_str); }
+    else if (index.is_open())
+    { search_path = index.root(); }
     else
     { search_path = std::filesystem::current_path(); }
 
-    // Запуск потока для обхода директорий.
-    std::thread walker_thread(&Walker::walk, &walker, std::ref(search_path), std::ref(recursively));
+    std::error_code error;
+    if (!std::filesystem::exists(search_path, error))
+    {
+        std::cerr << invalid_arguments(invalid_arguments::code::invalid, path_str + " (путь не существует).").what() << std::endl;
+        return 1;
+    }
+    if (index.is_open() && !index.covers(search_path))
+    {
+        std::cerr << invalid_arguments(invalid_arguments::code::invalid, path_str + " (путь вне директории индекса " + index.root().string() + ").").what() << std::endl;
+        return 1;
+    }
+
+    // Периодический вывод прогресса.
+    std::mutex mutex_progress;
+    std::condition_variable condition_progress;
+    bool finished = false;
+    std::thread progress_thread;
+    if (progress)
+    {
+        progress_thread = std::thread([&]()
+        {
+            std::unique_lock<std::mutex> lock(mutex_progress);
+            while (!condition_progress.wait_for(lock, std::chrono::seconds(1), [&finished]() { return finished; }))
+            { stats->progress(std::cerr); }
+        });
+    }
 
-    // Запуск потоков для поиска в файлах.
-    std::vector<std::thread> searcher_threads;
-    for (int i = 0; i < threads_number; ++i)
+    // Поиск в потоках библиотеки; вывод форматируется и пишется в stdout. Если читатель вывода завершился,
+    // ошибка записи отменяет поиск вместо завершения программы сигналом.
+    std::signal(SIGPIPE, SIG_IGN);
+    std::shared_ptr<Output> output = std::make_shared<Output>(STDOUT_FILENO, sorted, output_mode);
+    if (!index_file.empty())
     {
-        searcher_threads.push_back(std::thread(&Walker::search, std::ref(walker)));
+        // Файлы, изменённые или добавленные после построения индекса, просматриваются полностью. Пути
+        // выводятся в той же форме, что и при обходе search_path.
+        size_t changed = 0;
+        std::vector<std::filesystem::path> candidates = index.candidates(search->get_searcher().required_literals(), search_path, threads_number, changed);
+        if (changed)
+        { std::cerr << "Индекс устарел: файлов изменено или добавлено после построения - " << changed << " (обновите индекс с --index-build)." << std::endl; }
+        search->run(candidates, output);
     }
+    else { search->run(search_path, output); }
 
-    // Ожидание завершения работы потоков.
-    walker_thread.join();
-    for (int i = 0; i < threads_number; ++i)
+    if (progress)
     {
-        searcher_threads[i].join();
+        { std::unique_lock<std::mutex> lock(mutex_progress); finished = true; }
+        condition_progress.notify_all();
+        progress_thread.join();
     }
+    if (stats_requested) { stats->report(std::cerr, true); }
+    if (cache && !cache->save())
+    { std::cerr << "Не удалось записать кэш: " << cache_file << std::endl; }
 
     std::clock_t timestamp_finished = std::clock();
+    auto wall_finished = std::chrono::steady_clock::now();
     if (benchmark)
     {
+        // Время по настенным часам и суммарное процессорное время всех потоков.
         std::cout << std::fixed << std::setprecision(2)
                   << "[BENCHMARK]: " << std::endl
+                  << "Время: "
+                  << std::chrono::duration<double, std::milli>(wall_finished - wall_started).count() << "ms" << std::endl
                   << "CPU: "
                   << 1000.0 * (timestamp_finished - timestamp_started) / CLOCKS_PER_SEC << "ms" << std::endl
-                  << "CPU средн.:"
-                  << 1000.0 * (timestamp_finished - timestamp_started) / CLOCKS_PER_SEC / threads_number << "ms" << std::endl
                   << std::defaultfloat;
     }
 
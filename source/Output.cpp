@@ -0,0 +1,281 @@
+#include "Output.hpp"
+#include <charconv>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Добавление пути в кавычках, как при выводе std::filesystem::path в поток.
+static void append_quoted(std::string& buffer, const std::string& path)
+{
+    buffer.push_back('"');
+    for (char ch : path)
+    {
+        if (ch == '"' || ch == '\\') { buffer.push_back('\\'); }
+        buffer.push_back(ch);
+    }
+    buffer.push_back('"');
+}
+
+// Запись буффера в файл по смещению offset. Возвращает false при ошибке.
+static bool write_at(int descriptor, const std::string& buffer, uint64_t offset)
+{
+    const char* data = buffer.data();
+    size_t left = buffer.size();
+    while (left)
+    {
+        ssize_t written = pwrite(descriptor, data, left, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        data += written;
+        left -= written;
+        offset += written;
+    }
+    return true;
+}
+
+//////////////// Output::Arena  ////////////////
+// Буффер вывода одного потока поиска.
+// PUBLIC:
+Output::Arena::Arena(Output& init_output) : output(init_output)
+{
+    buffer = output.take_buffer();
+    last_flush = std::chrono::steady_clock::now();
+}
+
+Output::Arena::~Arena()
+{
+    flush();
+}
+
+void Output::Arena::add(const std::filesystem::path& file, const std::vector<Searcher::Entry>& entries, const Searcher& searcher)
+{
+    if (output.callback)
+    {
+        output.callback(file, entries);
+        return;
+    }
+
+    const std::string& path = file.native();
+    for (const Searcher::Entry& entry : entries)
+    {
+        append_quoted(buffer, path);
+        buffer.append("\t ");
+
+        char number[24];
+        buffer.append(number, std::to_chars(number, number + sizeof(number), entry.line_number).ptr);
+
+        // При поиске нескольких образцов выводятся найденные в строке образцы.
+        if (!entry.patterns.empty())
+        {
+            buffer.append(" [");
+            for (size_t i = 0; i < entry.patterns.size(); ++i)
+            {
+                if (i) { buffer.append(", "); }
+                buffer.append(searcher.get_pattern(entry.patterns[i]));
+            }
+            buffer.push_back(']');
+        }
+
+        buffer.append(": ");
+        buffer.append(entry.line);
+        buffer.push_back('\n');
+    }
+}
+
+void Output::Arena::add_file(const std::filesystem::path& file, const std::vector<Searcher::Entry>& entries)
+{
+    if (output.callback)
+    {
+        output.callback(file, entries);
+        return;
+    }
+
+    append_quoted(buffer, file.native());
+    if (output.mode == Mode::counts)
+    {
+        char number[24];
+        buffer.append("\t ");
+        buffer.append(number, std::to_chars(number, number + sizeof(number), entries.size()).ptr);
+    }
+    buffer.push_back('\n');
+}
+
+void Output::Arena::end_file(const std::filesystem::path& file)
+{
+    if (output.sorted)
+    {
+        if (!buffer.empty()) { output.submit(file, buffer); }
+        return;
+    }
+
+    // Буффер передаётся на запись при заполнении или если вывод задерживается слишком долго.
+    if (buffer.size() >= arena_size ||
+        (!buffer.empty() && std::chrono::steady_clock::now() - last_flush >= flush_interval))
+    { flush(); }
+}
+
+void Output::Arena::flush()
+{
+    if (buffer.empty()) { return; }
+    output.submit(buffer);
+    last_flush = std::chrono::steady_clock::now();
+}
+
+// PROTECTED:
+
+// PRIVATE:
+
+
+////////////////     Output     ////////////////
+// Класс для вывода найденных вхождений.
+// PUBLIC:
+Output::Output(int init_descriptor, bool init_sorted) :
+    Output(init_descriptor, init_sorted, Mode::lines)
+{}
+
+Output::Output(int init_descriptor, bool init_sorted, Mode init_mode)
+{
+    descriptor = init_descriptor;
+    sorted = init_sorted;
+    mode = init_mode;
+
+    // Вывод в режиме сортировки до завершения поиска хранится в удалённом временном файле.
+    if (sorted)
+    {
+        const char* directory = std::getenv("TMPDIR");
+        std::string name = std::string((directory && *directory) ? directory : "/tmp") + "/psearch.XXXXXX";
+        spill = mkostemp(name.data(), O_CLOEXEC);
+        if (spill >= 0) { unlink(name.c_str()); }
+    }
+    writer = std::thread(&Output::write_loop, this);
+}
+
+Output::Output(Callback init_callback, Mode init_mode)
+{
+    callback = std::move(init_callback);
+    mode = init_mode;
+}
+
+Output::~Output()
+{
+    finish();
+    if (spill >= 0) { close(spill); }
+}
+
+void Output::finish()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_blocks);
+        if (stopping) { return; }
+        stopping = true;
+    }
+    condition_blocks.notify_all();
+    if (writer.joinable()) { writer.join(); }
+
+    // В режиме сортировки файлы выводятся в порядке путей; части из временного файла читаются
+    // буффером размера arena_size.
+    std::string buffer;
+    for (auto& [file, output] : files)
+    {
+        for (auto [offset, size] : output.ranges)
+        {
+            while (size && !closed)
+            {
+                buffer.resize(size < arena_size ? size : arena_size);
+                ssize_t count = pread(spill, buffer.data(), buffer.size(), offset);
+                if (count < 0 && errno == EINTR) { continue; }
+                if (count <= 0) { break; }
+                buffer.resize(count);
+                write_all(buffer);
+                offset += count;
+                size -= count;
+            }
+        }
+        write_all(output.text);
+    }
+    files.clear();
+}
+
+// PROTECTED:
+void Output::submit(std::string& buffer)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_blocks);
+        condition_space.wait(lock, [this]() { return blocks.size() < max_blocks; });
+        blocks.push_back(std::move(buffer));
+        buffer = free_buffers.empty() ? std::string() : std::move(free_buffers.back());
+        if (!free_buffers.empty()) { free_buffers.pop_back(); }
+    }
+    condition_blocks.notify_one();
+}
+
+void Output::submit(const std::filesystem::path& file, std::string& buffer)
+{
+    // Если запись во временный файл не удалась (например, нет места), вывод хранится в памяти.
+    std::unique_lock<std::mutex> lock(mutex_blocks);
+    Sorted& output = files[file];
+    if (spill >= 0 && write_at(spill, buffer, spill_size))
+    {
+        output.ranges.emplace_back(spill_size, buffer.size());
+        spill_size += buffer.size();
+    }
+    else { output.text.append(buffer); }
+    buffer.clear();
+}
+
+std::string Output::take_buffer()
+{
+    std::unique_lock<std::mutex> lock(mutex_blocks);
+    if (free_buffers.empty()) { return std::string(); }
+    std::string buffer = std::move(free_buffers.back());
+    free_buffers.pop_back();
+    return buffer;
+}
+
+void Output::write_all(const std::string& buffer)
+{
+    if (closed) { return; }
+    const char* data = buffer.data();
+    size_t left = buffer.size();
+    while (left)
+    {
+        ssize_t written = write(descriptor, data, left);
+        if (written < 0)
+        {
+            if (errno == EINTR) { continue; }
+            // Вывод закрыт (например, EPIPE при игнорируемом SIGPIPE): оставшиеся данные отбрасываются.
+            closed = true;
+            return;
+        }
+        data += written;
+        left -= written;
+    }
+}
+
+void Output::write_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_blocks);
+    while (true)
+    {
+        condition_blocks.wait(lock, [this]() { return stopping || !blocks.empty(); });
+        if (blocks.empty()) { break; }
+
+        std::string buffer = std::move(blocks.front());
+        blocks.pop_front();
+        condition_space.notify_one();
+
+        // Запись выполняется без блокировки очереди.
+        lock.unlock();
+        write_all(buffer);
+        buffer.clear();
+        lock.lock();
+
+        free_buffers.push_back(std::move(buffer));
+    }
+}
+
+// PRIVATE:
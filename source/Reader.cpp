@@ -0,0 +1,396 @@
+#include "Reader.hpp"
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// Системные вызовы io_uring (обёрток в glibc нет).
+static int io_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int descriptor, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, descriptor, to_submit, min_complete, flags, nullptr, 0);
+}
+
+// Буфферы чтений, оставшихся в ядре после отказа кольца (см. Reader::abandon). Ядро может писать в них
+// и после закрытия кольца, поэтому они не освобождаются до завершения процесса.
+static std::mutex mutex_abandoned;
+static std::vector<std::unique_ptr<char[]>> abandoned_buffers;
+
+////////////////    ReadPool    ////////////////
+// Пул потоков блокирующего чтения.
+// PUBLIC:
+ReadPool::ReadPool(size_t threads_number)
+{
+    for (size_t i = 0; i < std::max<size_t>(threads_number, 1); ++i) { threads.emplace_back(&ReadPool::work, this); }
+}
+
+ReadPool::~ReadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_jobs);
+        stopping = true;
+    }
+    condition_jobs.notify_all();
+    for (std::thread& thread : threads) { thread.join(); }
+}
+
+void ReadPool::run(std::function<void()>&& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_jobs);
+        jobs.push_back(std::move(job));
+    }
+    condition_jobs.notify_one();
+}
+
+// PROTECTED:
+void ReadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_jobs);
+            condition_jobs.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty()) { return; }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+// PRIVATE:
+
+////////////////     Reader     ////////////////
+// Асинхронное чтение файлов целиком в буфферы.
+// PUBLIC:
+Reader::Reader(Backend init_backend, std::shared_ptr<ReadPool> init_pool, size_t init_depth, size_t init_memory)
+{
+    backend = init_backend;
+    pool = init_pool;
+    memory = init_memory;
+    slots.resize(std::max<size_t>(init_depth, 1));
+
+    // Если кольцо создать не удалось (например, из-за ограничений памяти), чтение выполняется синхронно.
+    if (backend == Backend::uring && !setup_ring(slots.size())) { backend = Backend::none; }
+    if (backend == Backend::threads && !pool) { backend = Backend::none; }
+}
+
+Reader::~Reader()
+{
+    // Буфферы освобождаются только после завершения всех чтений. Чтения отказавшего кольца не ожидаются:
+    // их буфферы уже переданы в abandoned_buffers.
+    if (backend == Backend::uring && !failed)
+    {
+        while (in_flight)
+        {
+            flush();
+            reap();
+            if (in_flight) { io_uring_enter(ring.descriptor, 0, 1, IORING_ENTER_GETEVENTS); }
+        }
+    }
+    else if (backend == Backend::threads)
+    {
+        std::unique_lock<std::mutex> lock(mutex_slots);
+        condition_slots.wait(lock, [this]() { return !in_flight; });
+    }
+    for (Slot& slot : slots)
+    {
+        if (slot.descriptor >= 0) { close(slot.descriptor); }
+    }
+
+    if (ring.sqes_memory) { munmap(ring.sqes_memory, ring.sqes_memory_size); }
+    if (ring.cq_memory && ring.cq_memory != ring.sq_memory) { munmap(ring.cq_memory, ring.cq_memory_size); }
+    if (ring.sq_memory) { munmap(ring.sq_memory, ring.sq_memory_size); }
+    if (ring.descriptor >= 0) { close(ring.descriptor); }
+}
+
+bool Reader::submit(const char* path, size_t size, uint64_t tag)
+{
+    if (backend == Backend::none || failed || !size) { return false; }
+
+    auto free_slot = std::find_if(slots.begin(), slots.end(), [](const Slot& slot) { return !slot.used; });
+    if (free_slot == slots.end()) { return false; }
+    Slot& slot = *free_slot;
+    if (!acquire(size, slot.buffer)) { return false; }
+
+    slot.tag = tag;
+    slot.used = true;
+    slot.size = size;
+    slot.result = 0;
+    slot.descriptor = open(path, O_RDONLY | O_CLOEXEC);
+    slot.opened = slot.descriptor >= 0;
+
+    // Файл, который не удалось открыть, считается прочитанным сразу.
+    if (!slot.opened)
+    {
+        slot.done = true;
+        return true;
+    }
+    slot.done = false;
+    const size_t index = &slot - slots.data();
+
+    if (backend == Backend::uring)
+    {
+        // Места в кольце хватает всегда: число мест в очереди не больше числа записей кольца.
+        slot.iovec.iov_base = slot.buffer.data.get();
+        slot.iovec.iov_len = size;
+        const unsigned tail = *ring.sq_tail;
+        const unsigned position = tail & *ring.sq_mask;
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(ring.sqes_memory) + position;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = slot.descriptor;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot.iovec);
+        sqe->len = 1;
+        sqe->off = 0;
+        sqe->user_data = index;
+        ring.sq_array[position] = position;
+        __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++ring.unsubmitted;
+        ++in_flight;
+    }
+    else
+    {
+        // Упреждающее чтение в ядре начинается сразу; поток пула затем копирует уже читаемые страницы.
+        posix_fadvise(slot.descriptor, 0, size, POSIX_FADV_WILLNEED);
+        {
+            std::unique_lock<std::mutex> lock(mutex_slots);
+            ++in_flight;
+        }
+        pool->run([this, index]()
+        {
+            Slot& slot = slots[index];
+            const long result = read_all(slot.descriptor, slot.buffer.data.get(), slot.size, 0);
+            {
+                std::unique_lock<std::mutex> lock(mutex_slots);
+                slot.result = result;
+                slot.done = true;
+                --in_flight;
+            }
+            condition_slots.notify_all();
+        });
+    }
+    return true;
+}
+
+void Reader::flush()
+{
+    if (backend != Backend::uring || failed || !ring.unsubmitted) { return; }
+    const int submitted = io_uring_enter(ring.descriptor, ring.unsubmitted, 0, 0);
+    if (submitted > 0) { ring.unsubmitted -= submitted; }
+}
+
+Reader::Read Reader::wait(uint64_t tag)
+{
+    auto found = std::find_if(slots.begin(), slots.end(), [tag](const Slot& slot) { return slot.used && slot.tag == tag; });
+    if (found == slots.end()) { return Read(); }
+    Slot& slot = *found;
+
+    if (backend == Backend::uring)
+    {
+        while (!slot.done)
+        {
+            reap();
+            if (slot.done) { break; }
+            const int submitted = io_uring_enter(ring.descriptor, ring.unsubmitted, 1, IORING_ENTER_GETEVENTS);
+            if (submitted > 0) { ring.unsubmitted -= submitted; }
+            else if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) { abandon(); }
+        }
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(mutex_slots);
+        condition_slots.wait(lock, [&slot]() { return slot.done; });
+    }
+
+    complete(slot);
+    Read read;
+    read.data = slot.buffer.data.get();
+    read.size = slot.result > 0 ? slot.result : 0;
+    read.opened = slot.opened;
+    return read;
+}
+
+void Reader::release(uint64_t tag)
+{
+    auto found = std::find_if(slots.begin(), slots.end(), [tag](const Slot& slot) { return slot.used && slot.tag == tag; });
+    if (found == slots.end()) { return; }
+    free_buffers.push_back(std::move(found->buffer));
+    found->buffer = Buffer();
+    found->used = false;
+}
+
+bool Reader::uring_supported()
+{
+    struct io_uring_params params = {};
+    const int descriptor = io_uring_setup(1, &params);
+    if (descriptor < 0) { return false; }
+    close(descriptor);
+    return true;
+}
+
+// PROTECTED:
+bool Reader::acquire(size_t size, Buffer& buffer)
+{
+    const size_t capacity = (size + buffer_granularity - 1) / buffer_granularity * buffer_granularity;
+
+    // Подходящий свободный буффер наименьшего размера.
+    auto best = free_buffers.end();
+    for (auto item = free_buffers.begin(); item != free_buffers.end(); ++item)
+    {
+        if (item->capacity >= capacity && (best == free_buffers.end() || item->capacity < best->capacity)) { best = item; }
+    }
+    if (best != free_buffers.end())
+    {
+        buffer = std::move(*best);
+        *best = std::move(free_buffers.back());
+        free_buffers.pop_back();
+        return true;
+    }
+
+    // Для нового буффера при нехватке объёма освобождаются свободные.
+    while (allocated + capacity > memory && !free_buffers.empty())
+    {
+        allocated -= free_buffers.back().capacity;
+        free_buffers.pop_back();
+    }
+    if (allocated + capacity > memory) { return false; }
+    buffer.data.reset(new char[capacity]);
+    buffer.capacity = capacity;
+    allocated += capacity;
+    return true;
+}
+
+bool Reader::setup_ring(unsigned entries)
+{
+    struct io_uring_params params = {};
+    ring.descriptor = io_uring_setup(entries, &params);
+    if (ring.descriptor < 0) { return false; }
+
+    // Очередь запросов, очередь завершений и массив запросов отображаются в память; в новых ядрах
+    // обе очереди находятся в одной области.
+    ring.sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) { ring.sq_memory_size = ring.cq_memory_size = std::max(ring.sq_memory_size, ring.cq_memory_size); }
+
+    void* sq_memory = mmap(nullptr, ring.sq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.descriptor, IORING_OFF_SQ_RING);
+    if (sq_memory == MAP_FAILED) { return false; }
+    ring.sq_memory = sq_memory;
+
+    void* cq_memory = sq_memory;
+    if (!single_mmap)
+    {
+        cq_memory = mmap(nullptr, ring.cq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.descriptor, IORING_OFF_CQ_RING);
+        if (cq_memory == MAP_FAILED) { return false; }
+    }
+    ring.cq_memory = cq_memory;
+
+    ring.sqes_memory_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes_memory = mmap(nullptr, ring.sqes_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.descriptor, IORING_OFF_SQES);
+    if (sqes_memory == MAP_FAILED) { return false; }
+    ring.sqes_memory = sqes_memory;
+
+    char* sq = static_cast<char*>(sq_memory);
+    char* cq = static_cast<char*>(cq_memory);
+    ring.sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring.sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring.sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring.sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring.cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring.cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring.cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring.cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+void Reader::reap()
+{
+    unsigned head = *ring.cq_head;
+    const unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe& cqe = static_cast<const struct io_uring_cqe*>(ring.cqes)[head & *ring.cq_mask];
+        Slot& slot = slots[cqe.user_data];
+        slot.result = cqe.res;
+        slot.done = true;
+        --in_flight;
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+void Reader::abandon()
+{
+    // Кольцо, на котором io_uring_enter завершается ошибкой, не позволяет ни дождаться завершений, ни
+    // передать запросы отмены (IORING_OP_ASYNC_CANCEL). Незавершённые чтения остаются в ядре, поэтому их
+    // буфферы больше не используются: они переходят в abandoned_buffers, а места очереди получают новые
+    // буфферы и читаются синхронно в complete. Новые чтения через кольцо не ставятся.
+    failed = true;
+    for (Slot& slot : slots)
+    {
+        if (!slot.used || slot.done) { continue; }
+        allocated -= slot.buffer.capacity;
+        {
+            std::unique_lock<std::mutex> lock(mutex_abandoned);
+            abandoned_buffers.push_back(std::move(slot.buffer.data));
+        }
+        slot.buffer = Buffer();
+
+        // Освободившегося объёма хватает на замену всех оставленных буфферов.
+        if (!acquire(slot.size, slot.buffer))
+        {
+            close(slot.descriptor);
+            slot.descriptor = -1;
+            slot.opened = false;
+        }
+        slot.result = -ECANCELED;
+        slot.done = true;
+    }
+    in_flight = 0;
+    ring.unsubmitted = 0;
+}
+
+void Reader::complete(Slot& slot)
+{
+    if (slot.descriptor < 0) { return; }
+
+    // Короткое чтение дочитывается синхронно; при ошибке асинхронного чтения (например, если операция
+    // не поддерживается ядром) файл читается заново.
+    if (slot.result < 0) { slot.result = read_all(slot.descriptor, slot.buffer.data.get(), slot.size, 0); }
+    else if (static_cast<size_t>(slot.result) < slot.size)
+    {
+        const long rest = read_all(slot.descriptor, slot.buffer.data.get() + slot.result, slot.size - slot.result, slot.result);
+        if (rest > 0) { slot.result += rest; }
+    }
+    close(slot.descriptor);
+    slot.descriptor = -1;
+}
+
+long Reader::read_all(int descriptor, char* data, size_t size, size_t offset)
+{
+    size_t filled = 0;
+    while (filled < size)
+    {
+        const ssize_t count = pread(descriptor, data + filled, size - filled, offset + filled);
+        if (count < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return filled ? static_cast<long>(filled) : -errno;
+        }
+        if (count == 0) { break; }
+        filled += count;
+    }
+    return filled;
+}
+
+// PRIVATE:
@@ -0,0 +1,961 @@
+#include "Regex.hpp"
+#include "CaseFold.hpp"
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+
+// Разметка значений в таблице переходов кэша ДКА.
+static const uint32_t unknown_transition = 0xFFFFFFFF; // Переход ещё не вычислен.
+static const uint32_t match_flag = 1u << 30;           // Переход завершает совпадение.
+static const uint32_t start_flag = 1u << 29;           // Переход ведёт в начальное состояние (можно применить префильтр).
+static const uint32_t special_mask = 0xE0000000;       // Переход требует обработки вне основного цикла.
+static const uint32_t state_mask = start_flag - 1;     // Номер состояния.
+
+static const uint32_t max_codepoint = 0x10FFFF;
+static const size_t max_nfa_size = 1 << 20;
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> Ranges;
+typedef std::vector<std::pair<unsigned char, unsigned char>> ByteSequence;
+
+// Упорядочивание и слияние диапазонов кодовых точек.
+static void normalize(Ranges& ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+    Ranges merged;
+    for (auto& range : ranges)
+    {
+        if (!merged.empty() && range.first <= merged.back().second + 1)
+        { merged.back().second = std::max(merged.back().second, range.second); }
+        else
+        { merged.push_back(range); }
+    }
+    ranges.swap(merged);
+}
+
+// Дополнение множества кодовых точек. Перевод строки исключается: совпадения не выходят за пределы строки.
+static void negate(Ranges& ranges)
+{
+    normalize(ranges);
+    Ranges complement;
+    uint32_t next = 0;
+    for (auto& range : ranges)
+    {
+        if (range.first > next) { complement.push_back({next, range.first - 1}); }
+        next = range.second + 1;
+    }
+    if (next <= max_codepoint) { complement.push_back({next, max_codepoint}); }
+
+    Ranges result;
+    for (auto& range : complement)
+    {
+        if (range.first <= '\n' && range.second >= '\n')
+        {
+            if (range.first < '\n') { result.push_back({range.first, '\n' - 1}); }
+            if (range.second > '\n') { result.push_back({'\n' + 1, range.second}); }
+        }
+        else { result.push_back(range); }
+    }
+    ranges.swap(result);
+}
+
+// Добавление вариантов регистра всех кодовых точек множества.
+static void add_cases(Ranges& ranges)
+{
+    Ranges added;
+    for (auto& range : ranges)
+    {
+        for (uint32_t codepoint = range.first; codepoint <= std::min(range.second, CaseFold::max_cased); ++codepoint)
+        {
+            for (uint32_t variant : CaseFold::variants(codepoint))
+            {
+                if (variant != codepoint) { added.push_back({variant, variant}); }
+            }
+        }
+    }
+    ranges.insert(ranges.end(), added.begin(), added.end());
+}
+
+// Кодирование кодовой точки в UTF-8.
+static size_t encode(uint32_t codepoint, unsigned char* bytes)
+{
+    if (codepoint < 0x80) { bytes[0] = codepoint; return 1; }
+    if (codepoint < 0x800)
+    {
+        bytes[0] = 0xC0 | (codepoint >> 6);
+        bytes[1] = 0x80 | (codepoint & 0x3F);
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        bytes[0] = 0xE0 | (codepoint >> 12);
+        bytes[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+        bytes[2] = 0x80 | (codepoint & 0x3F);
+        return 3;
+    }
+    bytes[0] = 0xF0 | (codepoint >> 18);
+    bytes[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+    bytes[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+    bytes[3] = 0x80 | (codepoint & 0x3F);
+    return 4;
+}
+
+// Разбиение диапазона кодовых точек на последовательности диапазонов байтов UTF-8.
+static void utf8_sequences(uint32_t low, uint32_t high, std::vector<ByteSequence>& sequences)
+{
+    // Суррогатные кодовые точки не кодируются.
+    if (low <= 0xDFFF && high >= 0xD800)
+    {
+        if (low < 0xD800) { utf8_sequences(low, 0xD7FF, sequences); }
+        if (high > 0xDFFF) { utf8_sequences(0xE000, high, sequences); }
+        return;
+    }
+
+    // Диапазон разбивается так, чтобы все его кодовые точки кодировались одинаковым числом байтов.
+    for (uint32_t limit : {0x7Fu, 0x7FFu, 0xFFFFu})
+    {
+        if (low <= limit && high > limit)
+        {
+            utf8_sequences(low, limit, sequences);
+            utf8_sequences(limit + 1, high, sequences);
+            return;
+        }
+    }
+
+    // Диапазон разбивается так, чтобы каждый байт кодировки пробегал непрерывный диапазон.
+    unsigned char low_bytes[4];
+    unsigned char high_bytes[4];
+    const size_t length = encode(low, low_bytes);
+    for (size_t i = 1; i < length; ++i)
+    {
+        const uint32_t mask = (1u << (6 * i)) - 1;
+        if ((low & ~mask) != (high & ~mask))
+        {
+            if ((low & mask) != 0)
+            {
+                utf8_sequences(low, low | mask, sequences);
+                utf8_sequences((low | mask) + 1, high, sequences);
+                return;
+            }
+            if ((high & mask) != mask)
+            {
+                utf8_sequences(low, (high & ~mask) - 1, sequences);
+                utf8_sequences(high & ~mask, high, sequences);
+                return;
+            }
+        }
+    }
+
+    encode(high, high_bytes);
+    ByteSequence sequence;
+    for (size_t i = 0; i < length; ++i) { sequence.push_back({low_bytes[i], high_bytes[i]}); }
+    sequences.push_back(sequence);
+}
+
+
+////////////////  Regex::Node   ////////////////
+// Узел синтаксического дерева выражения.
+struct Regex::Node
+{
+    enum class Type
+    {
+        empty,         // Пустая строка.
+        characters,    // Один символ из множества ranges.
+        concatenation, // Последовательность children.
+        alternation,   // Один из вариантов children.
+        repetition,    // Повторение children[0] от min до max раз (max < 0 - без ограничения).
+        line_begin,    // Начало строки.
+        line_end,      // Конец строки.
+    };
+
+    Type type = Type::empty;
+    Ranges ranges;
+    std::vector<Node> children;
+    int min = 0;
+    int max = -1;
+};
+
+//////////////// Regex::Fragment ///////////////
+// Фрагмент НКА: начальное состояние и список неприсоединённых выходов (номер состояния, альтернативный ли выход).
+struct Regex::Fragment
+{
+    uint32_t start;
+    std::vector<std::pair<uint32_t, bool>> outs;
+};
+
+//////////////// Regex::Parser  ////////////////
+// Синтаксический анализатор выражения (рекурсивный спуск).
+class Regex::Parser
+{
+public:
+    Parser(const std::string& init_expression, bool init_case_insensitive) :
+        expression(init_expression), case_insensitive(init_case_insensitive)
+    {}
+
+    Node parse()
+    {
+        Node node = parse_alternation();
+        if (position != expression.size()) { error("непарная закрывающая скобка"); }
+        return node;
+    }
+
+protected:
+    const std::string& expression;
+    bool case_insensitive; // Множества символов дополняются вариантами регистра.
+    size_t position = 0;
+
+    [[noreturn]] void error(const std::string& message) const
+    { throw std::invalid_argument(message + " (позиция " + std::to_string(position) + ")"); }
+
+    bool at_end() const { return position >= expression.size(); }
+    char peek() const { return expression[position]; }
+
+    // Декодирование очередного символа UTF-8.
+    uint32_t next_codepoint()
+    {
+        const unsigned char first = expression[position++];
+        if (first < 0x80) { return first; }
+
+        size_t length;
+        uint32_t codepoint;
+        if ((first & 0xE0) == 0xC0) { length = 1; codepoint = first & 0x1F; }
+        else if ((first & 0xF0) == 0xE0) { length = 2; codepoint = first & 0x0F; }
+        else if ((first & 0xF8) == 0xF0) { length = 3; codepoint = first & 0x07; }
+        else { error("некорректная кодировка UTF-8"); }
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (at_end() || (static_cast<unsigned char>(peek()) & 0xC0) != 0x80) { error("некорректная кодировка UTF-8"); }
+            codepoint = (codepoint << 6) | (static_cast<unsigned char>(expression[position++]) & 0x3F);
+        }
+        return codepoint;
+    }
+
+    Node characters(Ranges ranges) const
+    {
+        Node node;
+        node.type = Node::Type::characters;
+        node.ranges = std::move(ranges);
+        if (case_insensitive) { add_cases(node.ranges); }
+        normalize(node.ranges);
+        return node;
+    }
+
+    Node parse_alternation()
+    {
+        Node node;
+        node.type = Node::Type::alternation;
+        node.children.push_back(parse_concatenation());
+        while (!at_end() && peek() == '|')
+        {
+            ++position;
+            node.children.push_back(parse_concatenation());
+        }
+        if (node.children.size() == 1) { return std::move(node.children.front()); }
+        return node;
+    }
+
+    Node parse_concatenation()
+    {
+        Node node;
+        node.type = Node::Type::concatenation;
+        while (!at_end() && peek() != '|' && peek() != ')')
+        { node.children.push_back(parse_repetition()); }
+
+        if (node.children.empty()) { return Node(); }
+        if (node.children.size() == 1) { return std::move(node.children.front()); }
+        return node;
+    }
+
+    // Разбор неотрицательного числа в квантификаторе {m,n}.
+    int parse_number()
+    {
+        if (at_end() || !std::isdigit(static_cast<unsigned char>(peek()))) { error("ожидалось число в квантификаторе"); }
+        int number = 0;
+        while (!at_end() && std::isdigit(static_cast<unsigned char>(peek())))
+        {
+            number = number * 10 + (expression[position++] - '0');
+            if (number > 1000) { error("слишком большое число повторений"); }
+        }
+        return number;
+    }
+
+    Node parse_repetition()
+    {
+        Node node = parse_atom();
+        while (!at_end())
+        {
+            int min;
+            int max;
+            const char symbol = peek();
+            if (symbol == '*') { min = 0; max = -1; ++position; }
+            else if (symbol == '+') { min = 1; max = -1; ++position; }
+            else if (symbol == '?') { min = 0; max = 1; ++position; }
+            else if (symbol == '{')
+            {
+                ++position;
+                min = parse_number();
+                max = min;
+                if (!at_end() && peek() == ',')
+                {
+                    ++position;
+                    max = (!at_end() && peek() == '}') ? -1 : parse_number();
+                }
+                if (at_end() || peek() != '}') { error("ожидалась }"); }
+                ++position;
+                if (max >= 0 && max < min) { error("неверный диапазон повторений"); }
+            }
+            else { break; }
+
+            // Ленивые квантификаторы не влияют на факт наличия совпадения.
+            if (!at_end() && peek() == '?') { ++position; }
+
+            Node repetition;
+            repetition.type = Node::Type::repetition;
+            repetition.min = min;
+            repetition.max = max;
+            repetition.children.push_back(std::move(node));
+            node = std::move(repetition);
+        }
+        return node;
+    }
+
+    Node parse_atom()
+    {
+        const char symbol = peek();
+        switch (symbol)
+        {
+            case '(':
+            {
+                ++position;
+                if (expression.compare(position, 2, "?:") == 0) { position += 2; }
+                Node node = parse_alternation();
+                if (at_end() || peek() != ')') { error("ожидалась )"); }
+                ++position;
+                return node;
+            }
+            case '*': case '+': case '?': case '{': { error("нечего повторять"); }
+            case '.':
+            {
+                ++position;
+                Ranges ranges = {{'\n', '\n'}};
+                negate(ranges);
+                return characters(ranges);
+            }
+            case '^': { ++position; Node node; node.type = Node::Type::line_begin; return node; }
+            case '$': { ++position; Node node; node.type = Node::Type::line_end; return node; }
+            case '[': { ++position; return parse_class(); }
+            case '\\':
+            {
+                ++position;
+                Ranges ranges;
+                parse_escape(ranges);
+                return characters(ranges);
+            }
+            default:
+            {
+                const uint32_t codepoint = next_codepoint();
+                return characters({{codepoint, codepoint}});
+            }
+        }
+    }
+
+    // Разбор экранированной последовательности (после \). Результат добавляется в ranges.
+    // Возвращает true, если последовательность обозначает один символ.
+    bool parse_escape(Ranges& ranges)
+    {
+        if (at_end()) { error("незавершённая экранированная последовательность"); }
+        const char symbol = expression[position++];
+
+        Ranges escaped;
+        switch (symbol)
+        {
+            case 'd': case 'D': { escaped = {{'0', '9'}}; break; }
+            case 'w': case 'W': { escaped = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}}; break; }
+            case 's': case 'S': { escaped = {{'\t', '\r'}, {' ', ' '}}; break; }
+            case 'n': { ranges.push_back({'\n', '\n'}); return true; }
+            case 't': { ranges.push_back({'\t', '\t'}); return true; }
+            case 'r': { ranges.push_back({'\r', '\r'}); return true; }
+            case 'f': { ranges.push_back({'\f', '\f'}); return true; }
+            case 'v': { ranges.push_back({'\v', '\v'}); return true; }
+            case 'x':
+            {
+                uint32_t codepoint = 0;
+                for (int i = 0; i < 2; ++i)
+                {
+                    if (at_end() || !std::isxdigit(static_cast<unsigned char>(peek()))) { error("ожидалась шестнадцатеричная цифра"); }
+                    const char digit = expression[position++];
+                    codepoint = codepoint * 16 + (std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : (std::tolower(digit) - 'a' + 10));
+                }
+                ranges.push_back({codepoint, codepoint});
+                return true;
+            }
+            default:
+            {
+                if (std::isalnum(static_cast<unsigned char>(symbol))) { error(std::string("неизвестная экранированная последовательность \\") + symbol); }
+                --position;
+                const uint32_t codepoint = next_codepoint();
+                ranges.push_back({codepoint, codepoint});
+                return true;
+            }
+        }
+
+        if (std::isupper(static_cast<unsigned char>(symbol))) { negate(escaped); }
+        ranges.insert(ranges.end(), escaped.begin(), escaped.end());
+        return false;
+    }
+
+    // Разбор класса символов (после [).
+    Node parse_class()
+    {
+        bool negated = false;
+        if (!at_end() && peek() == '^') { negated = true; ++position; }
+
+        Ranges ranges;
+        bool first = true;
+        while (true)
+        {
+            if (at_end()) { error("ожидалась ]"); }
+            if (peek() == ']' && !first) { ++position; break; }
+            first = false;
+
+            // Начало элемента класса.
+            uint32_t low;
+            if (peek() == '\\')
+            {
+                ++position;
+                Ranges escaped;
+                if (!parse_escape(escaped))
+                {
+                    ranges.insert(ranges.end(), escaped.begin(), escaped.end());
+                    continue;
+                }
+                low = escaped.front().first;
+            }
+            else { low = next_codepoint(); }
+
+            // Возможный диапазон low-high.
+            uint32_t high = low;
+            if (position + 1 < expression.size() && peek() == '-' && expression[position + 1] != ']')
+            {
+                ++position;
+                if (peek() == '\\')
+                {
+                    ++position;
+                    Ranges escaped;
+                    if (!parse_escape(escaped)) { error("класс символов не может быть границей диапазона"); }
+                    high = escaped.front().first;
+                }
+                else { high = next_codepoint(); }
+                if (high < low) { error("неверный диапазон символов"); }
+            }
+            ranges.push_back({low, high});
+        }
+
+        // Без учёта регистра варианты добавляются до дополнения: [^a] не допускает и A.
+        if (negated)
+        {
+            if (case_insensitive) { add_cases(ranges); }
+            negate(ranges);
+        }
+        return characters(ranges);
+    }
+};
+
+//////////////// Regex::Cache   ////////////////
+// Кэш лениво построенных состояний ДКА. Используется одним потоком в каждый момент времени.
+class Regex::Cache
+{
+public:
+    // Состояние ДКА: упорядоченное множество состояний НКА.
+    struct State
+    {
+        std::vector<uint32_t> set;
+        bool match;     // Содержит допускающее состояние.
+        bool eol_match; // Допускает при достижении конца строки.
+    };
+
+    std::vector<uint32_t> transitions;               // Таблица переходов: состояние * число классов + класс.
+    std::vector<State> states;                       // Построенные состояния.
+    std::map<std::vector<uint32_t>, uint32_t> index; // Номера построенных состояний.
+    uint32_t line_start_id = 0;                      // Начальное состояние в начале строки.
+    uint32_t inner_start_id = 0;                     // Начальное состояние внутри строки.
+
+    Cache(const Regex& init_regex) : regex(init_regex)
+    {
+        transitions.reserve(regex.max_states * regex.classes_number);
+        reset();
+    }
+
+    // Очистка кэша. Начальные состояния создаются заново.
+    void reset()
+    {
+        transitions.clear();
+        states.clear();
+        index.clear();
+        line_start_id = intern(regex.line_start);
+        inner_start_id = intern(regex.inner_start);
+    }
+
+    // Вычисление и запоминание перехода из состояния state по байту byte. При переполнении кэш очищается,
+    // поэтому возвращаемое значение следует использовать вместо ранее полученных номеров состояний.
+    uint32_t transition(uint32_t state, unsigned char byte)
+    {
+        uint32_t target;
+        bool match;
+        if (byte == '\n')
+        {
+            // Перевод строки завершает строку и возвращает автомат в начальное состояние.
+            match = states[state].eol_match;
+            target = line_start_id;
+        }
+        else
+        {
+            // Переходы по байту и добавление нового потока, начинающегося со следующей позиции.
+            std::vector<uint32_t> seeds;
+            for (uint32_t nfa_state : states[state].set)
+            {
+                const NFAState& current = regex.nfa[nfa_state];
+                if (current.type == NFAState::Type::range && current.low <= byte && byte <= current.high)
+                { seeds.push_back(current.out); }
+            }
+            seeds.push_back(regex.nfa_start);
+            std::vector<uint32_t> set = regex.closure(seeds, false, false);
+
+            auto found = index.find(set);
+            if (found != index.end()) { target = found->second; }
+            else
+            {
+                if (states.size() >= regex.max_states)
+                {
+                    std::vector<uint32_t> current = states[state].set;
+                    reset();
+                    state = intern(current);
+                }
+                target = intern(set);
+            }
+            match = states[target].match;
+        }
+
+        uint32_t value = target;
+        if (match) { value |= match_flag; }
+        if (regex.prefilter && (target == line_start_id || target == inner_start_id)) { value |= start_flag; }
+        transitions[state * regex.classes_number + regex.class_map[byte]] = value;
+        return value;
+    }
+
+protected:
+    const Regex& regex;
+
+    uint32_t intern(const std::vector<uint32_t>& set)
+    {
+        auto found = index.find(set);
+        if (found != index.end()) { return found->second; }
+
+        bool match = false;
+        for (uint32_t nfa_state : set)
+        { match = match || (regex.nfa[nfa_state].type == NFAState::Type::match); }
+
+        const uint32_t id = states.size();
+        states.push_back(State{set, match, regex.matches_at_line_end(set)});
+        index.emplace(set, id);
+        transitions.resize(transitions.size() + regex.classes_number, unknown_transition);
+        return id;
+    }
+};
+
+
+////////////////      Regex     ////////////////
+// Класс, реализующий поиск по регулярному выражению с ленивым построением ДКА.
+// PUBLIC:
+Regex::Regex(const std::string& init_expression, bool init_case_insensitive)
+{
+    expression = init_expression;
+    case_insensitive = init_case_insensitive;
+
+    // Синтаксический анализ и построение НКА.
+    Node tree = Parser(expression, case_insensitive).parse();
+    Fragment fragment = compile(tree);
+    const uint32_t match = add_state(NFAState::Type::match);
+    patch(fragment, match);
+    nfa_start = fragment.start;
+
+    // Начальные множества состояний и классы эквивалентности байтов.
+    line_start = closure({nfa_start}, true, false);
+    inner_start = closure({nfa_start}, false, false);
+    empty_match = std::find(line_start.begin(), line_start.end(), match) != line_start.end();
+    build_classes();
+    max_states = std::max<size_t>(16, cache_capacity / (classes_number * sizeof(uint32_t)));
+
+    // Литеральный префикс используется для пропуска участков, в которых совпадений быть не может.
+    // Без учёта регистра префикс записывается в нижнем регистре и ищется без учёта регистра.
+    extract_prefix(tree, prefix, prefix_folded);
+    if (!prefix.empty()) { prefilter = std::make_unique<SIMD>(prefix, SIMD::best_kernel(), prefix_folded); }
+}
+
+Regex::~Regex() = default;
+
+void Regex::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    LineTracker lines(begin, end, entries, limits);
+
+    // Выражение, допускающее пустую строку, совпадает с каждой строкой.
+    if (empty_match)
+    {
+        for (const char* iter = begin; iter != end && !lines.full();)
+        {
+            lines.add(iter);
+            const void* next = std::memchr(iter, '\n', end - iter);
+            iter = next ? static_cast<const char*>(next) + 1 : end;
+        }
+        return;
+    }
+
+    std::unique_ptr<Cache> cache = acquire_cache();
+    uint32_t state = cache->line_start_id;
+    const char* iter = begin;
+    bool exhausted = false;
+
+    // Переход к следующему вхождению префикса. Начальное состояние выбирается по предыдущему символу.
+    auto skip = [&]()
+    {
+        iter = prefilter->find(iter, end);
+        if (iter == end) { return false; }
+        state = (iter == begin || iter[-1] == '\n') ? cache->line_start_id : cache->inner_start_id;
+        return true;
+    };
+
+    if (prefilter && !skip()) { exhausted = true; }
+
+    const uint32_t* transitions = cache->transitions.data();
+    while (!exhausted && iter != end)
+    {
+        const unsigned char byte = *iter;
+        uint32_t value = transitions[state * classes_number + class_map[byte]];
+        if (value & special_mask)
+        {
+            if (value == unknown_transition)
+            {
+                value = cache->transition(state, byte);
+                transitions = cache->transitions.data();
+            }
+
+            // Вхождения считаются по позициям, в которых оканчивается совпадение: автомат не сбрасывается
+            // после совпадения, и перекрывающиеся совпадения учитываются, как в остальных алгоритмах.
+            if (value & match_flag)
+            {
+                lines.add(iter);
+                if (lines.full()) { exhausted = true; break; }
+            }
+
+            if (value & start_flag)
+            {
+                ++iter;
+                if (!skip()) { exhausted = true; }
+                continue;
+            }
+        }
+        state = value & state_mask;
+        ++iter;
+    }
+
+    // Последняя строка может не оканчиваться переводом строки.
+    if (!exhausted && begin != end && end[-1] != '\n' && cache->states[state].eol_match)
+    { lines.add(end - 1); }
+
+    release_cache(std::move(cache));
+}
+
+std::string Regex::escape(const std::string& text)
+{
+    std::string result;
+    for (char ch : text)
+    {
+        if (ch && std::strchr("\\.[](){}*+?|^$", ch)) { result.push_back('\\'); }
+        result.push_back(ch);
+    }
+    return result;
+}
+
+// PROTECTED:
+Regex::Fragment Regex::compile(const Node& node)
+{
+    if (nfa.size() > max_nfa_size) { throw std::invalid_argument("слишком большое выражение"); }
+
+    switch (node.type)
+    {
+        case Node::Type::empty:
+        {
+            const uint32_t state = add_state(NFAState::Type::epsilon);
+            return Fragment{state, {{state, false}}};
+        }
+        case Node::Type::line_begin:
+        case Node::Type::line_end:
+        {
+            const uint32_t state = add_state(node.type == Node::Type::line_begin ? NFAState::Type::line_begin : NFAState::Type::line_end);
+            return Fragment{state, {{state, false}}};
+        }
+        case Node::Type::characters: { return compile_characters(node); }
+        case Node::Type::concatenation:
+        {
+            Fragment result = compile(node.children.front());
+            for (size_t i = 1; i < node.children.size(); ++i)
+            {
+                Fragment next = compile(node.children[i]);
+                patch(result, next.start);
+                result.outs = std::move(next.outs);
+            }
+            return result;
+        }
+        case Node::Type::alternation:
+        {
+            Fragment result = compile(node.children.front());
+            for (size_t i = 1; i < node.children.size(); ++i)
+            {
+                Fragment next = compile(node.children[i]);
+                const uint32_t split = add_state(NFAState::Type::split);
+                nfa[split].out = result.start;
+                nfa[split].out_alternative = next.start;
+                result.start = split;
+                result.outs.insert(result.outs.end(), next.outs.begin(), next.outs.end());
+            }
+            return result;
+        }
+        case Node::Type::repetition:
+        {
+            const Node& child = node.children.front();
+
+            // Обязательные повторения.
+            Fragment result{add_state(NFAState::Type::epsilon), {}};
+            result.outs.push_back({result.start, false});
+            for (int i = 0; i < node.min; ++i)
+            {
+                Fragment next = compile(child);
+                patch(result, next.start);
+                result.outs = std::move(next.outs);
+            }
+
+            if (node.max < 0)
+            {
+                // Неограниченное повторение: цикл через состояние-развилку.
+                Fragment loop = compile(child);
+                const uint32_t split = add_state(NFAState::Type::split);
+                nfa[split].out = loop.start;
+                patch(loop, split);
+                patch(result, split);
+                result.outs = {{split, true}};
+            }
+            else
+            {
+                // Необязательные повторения.
+                std::vector<std::pair<uint32_t, bool>> skipped;
+                for (int i = node.min; i < node.max; ++i)
+                {
+                    Fragment next = compile(child);
+                    const uint32_t split = add_state(NFAState::Type::split);
+                    nfa[split].out = next.start;
+                    patch(result, split);
+                    skipped.push_back({split, true});
+                    result.outs = std::move(next.outs);
+                }
+                result.outs.insert(result.outs.end(), skipped.begin(), skipped.end());
+            }
+            return result;
+        }
+    }
+    return Fragment();
+}
+
+Regex::Fragment Regex::compile_characters(const Node& node)
+{
+    // Каждый диапазон кодовых точек раскладывается в последовательности диапазонов байтов UTF-8.
+    std::vector<ByteSequence> sequences;
+    for (auto& range : node.ranges) { utf8_sequences(range.first, range.second, sequences); }
+
+    // Пустое множество символов не допускает ни одной строки.
+    if (sequences.empty())
+    {
+        const uint32_t state = add_state(NFAState::Type::range, 1, 0);
+        return Fragment{state, {{state, false}}};
+    }
+
+    Fragment result;
+    for (size_t i = 0; i < sequences.size(); ++i)
+    {
+        // Цепочка переходов для одной последовательности.
+        Fragment chain{static_cast<uint32_t>(nfa.size()), {}};
+        for (size_t j = 0; j < sequences[i].size(); ++j)
+        {
+            const uint32_t state = add_state(NFAState::Type::range, sequences[i][j].first, sequences[i][j].second);
+            if (j) { nfa[state - 1].out = state; }
+        }
+        chain.outs.push_back({static_cast<uint32_t>(nfa.size() - 1), false});
+
+        if (i == 0) { result = std::move(chain); continue; }
+
+        const uint32_t split = add_state(NFAState::Type::split);
+        nfa[split].out = result.start;
+        nfa[split].out_alternative = chain.start;
+        result.start = split;
+        result.outs.insert(result.outs.end(), chain.outs.begin(), chain.outs.end());
+    }
+    return result;
+}
+
+uint32_t Regex::add_state(NFAState::Type type, unsigned char low, unsigned char high)
+{
+    NFAState state;
+    state.type = type;
+    state.low = low;
+    state.high = high;
+    nfa.push_back(state);
+    return nfa.size() - 1;
+}
+
+void Regex::patch(const Fragment& fragment, uint32_t target)
+{
+    for (auto& [state, alternative] : fragment.outs)
+    {
+        if (alternative) { nfa[state].out_alternative = target; }
+        else { nfa[state].out = target; }
+    }
+}
+
+void Regex::build_classes()
+{
+    // Границы классов: начала диапазонов и позиции сразу после их концов. Перевод строки - отдельный класс.
+    bool boundary[257] = {};
+    boundary['\n'] = boundary['\n' + 1] = true;
+    for (const NFAState& state : nfa)
+    {
+        if (state.type == NFAState::Type::range)
+        {
+            boundary[state.low] = true;
+            boundary[state.high + 1] = true;
+        }
+    }
+
+    classes_number = 0;
+    for (size_t byte = 0; byte < 256; ++byte)
+    {
+        if (byte && boundary[byte]) { ++classes_number; }
+        class_map[byte] = classes_number;
+    }
+    ++classes_number;
+}
+
+bool Regex::extract_prefix(const Node& node, std::string& prefix, bool& folded)
+{
+    // Возвращает true, если узел целиком является литералом и префикс можно продолжать.
+    switch (node.type)
+    {
+        case Node::Type::empty:
+        case Node::Type::line_begin:
+        case Node::Type::line_end: { return true; }
+        case Node::Type::characters:
+        {
+            // Буква ASCII в обоих регистрах входит в префикс строчной; такой префикс ищется без учёта регистра.
+            const Ranges& ranges = node.ranges;
+            if (ranges.size() == 2 && ranges[0].first == ranges[0].second && ranges[1].first == ranges[1].second &&
+                ranges[0].first >= 'A' && ranges[0].first <= 'Z' && ranges[1].first == CaseFold::fold_ascii(ranges[0].first))
+            {
+                prefix.push_back(ranges[1].first);
+                folded = true;
+                return true;
+            }
+            if (ranges.size() != 1 || ranges.front().first != ranges.front().second) { return false; }
+            unsigned char bytes[4];
+            const size_t length = encode(node.ranges.front().first, bytes);
+            prefix.append(reinterpret_cast<const char*>(bytes), length);
+            return true;
+        }
+        case Node::Type::concatenation:
+        {
+            for (const Node& child : node.children)
+            {
+                if (!extract_prefix(child, prefix, folded)) { return false; }
+            }
+            return true;
+        }
+        case Node::Type::repetition:
+        {
+            if (node.min > 0) { extract_prefix(node.children.front(), prefix, folded); }
+            return false;
+        }
+        default: { return false; }
+    }
+}
+
+std::vector<uint32_t> Regex::closure(const std::vector<uint32_t>& seeds, bool at_line_begin, bool at_line_end) const
+{
+    // Обход пустых переходов. В множестве остаются только переходы по байтам, допускающее состояние
+    // и неразрешённые проверки конца строки.
+    std::vector<uint32_t> result;
+    std::vector<uint32_t> stack(seeds.rbegin(), seeds.rend());
+    std::vector<bool> visited(nfa.size(), false);
+    while (!stack.empty())
+    {
+        const uint32_t state = stack.back();
+        stack.pop_back();
+        if (visited[state]) { continue; }
+        visited[state] = true;
+
+        const NFAState& current = nfa[state];
+        switch (current.type)
+        {
+            case NFAState::Type::range:
+            case NFAState::Type::match: { result.push_back(state); break; }
+            case NFAState::Type::split: { stack.push_back(current.out_alternative); stack.push_back(current.out); break; }
+            case NFAState::Type::epsilon: { stack.push_back(current.out); break; }
+            case NFAState::Type::line_begin: { if (at_line_begin) { stack.push_back(current.out); } break; }
+            case NFAState::Type::line_end:
+            {
+                if (at_line_end) { stack.push_back(current.out); }
+                else { result.push_back(state); }
+                break;
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool Regex::matches_at_line_end(const std::vector<uint32_t>& set) const
+{
+    std::vector<uint32_t> seeds;
+    for (uint32_t state : set)
+    {
+        if (nfa[state].type == NFAState::Type::line_end) { seeds.push_back(nfa[state].out); }
+    }
+    if (seeds.empty()) { return false; }
+
+    for (uint32_t state : closure(seeds, false, true))
+    {
+        if (nfa[state].type == NFAState::Type::match) { return true; }
+    }
+    return false;
+}
+
+std::unique_ptr<Regex::Cache> Regex::acquire_cache() const
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_caches);
+        if (!caches.empty())
+        {
+            std::unique_ptr<Cache> cache = std::move(caches.back());
+            caches.pop_back();
+            return cache;
+        }
+    }
+    return std::make_unique<Cache>(*this);
+}
+
+void Regex::release_cache(std::unique_ptr<Cache> cache) const
+{
+    std::unique_lock<std::mutex> lock(mutex_caches);
+    caches.push_back(std::move(cache));
+}
+
+// PRIVATE:
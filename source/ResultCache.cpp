@@ -0,0 +1,228 @@
+#include "ResultCache.hpp"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Сигнатура файла кэша. Последний символ - версия формата (2: вхождения регулярного выражения считаются
+// по позициям окончания совпадений; 3: возраст записей).
+static const char cache_magic[8] = {'P', 'S', 'C', 'A', 'C', 'H', 'E', '3'};
+
+// Хэш FNV-1a: одинаков во всех запусках и сборках.
+static uint64_t fnv1a(const std::string& text)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (unsigned char ch : text)
+    {
+        hash ^= ch;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+static void append_value(std::string& buffer, T value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Чтение значения из [position, end). Возвращает false, если данных недостаточно.
+template <typename T>
+static bool read_value(const char*& position, const char* end, T& value)
+{
+    if (static_cast<size_t>(end - position) < sizeof(value)) { return false; }
+    std::memcpy(&value, position, sizeof(value));
+    position += sizeof(value);
+    return true;
+}
+
+////////////////  ResultCache   ////////////////
+// Постоянный кэш результатов поиска.
+// PUBLIC:
+ResultCache::ResultCache(const std::filesystem::path& init_path, const std::string& signature)
+{
+    path = init_path;
+    signature_hash = fnv1a(signature);
+    load();
+}
+
+bool ResultCache::claim(const Stamp& stamp)
+{
+    std::unique_lock<std::mutex> lock(mutex_records);
+    return claimed.insert(Key{stamp.device, stamp.inode}).second;
+}
+
+bool ResultCache::contains(const Stamp& stamp)
+{
+    std::unique_lock<std::mutex> lock(mutex_records);
+    auto found = records.find(Key{stamp.device, stamp.inode});
+    if (found == records.end() || found->second.mtime != stamp.mtime || found->second.size != stamp.size) { return false; }
+    found->second.used = true;
+    return true;
+}
+
+bool ResultCache::lookup(const Stamp& stamp, std::vector<Searcher::Entry>& entries)
+{
+    std::unique_lock<std::mutex> lock(mutex_records);
+    auto found = records.find(Key{stamp.device, stamp.inode});
+    if (found == records.end() || found->second.mtime != stamp.mtime || found->second.size != stamp.size) { return false; }
+    found->second.used = true;
+    entries.insert(entries.end(), found->second.entries.begin(), found->second.entries.end());
+    return true;
+}
+
+void ResultCache::store(const Stamp& stamp, const std::vector<Searcher::Entry>& entries)
+{
+    // Строки вхождений указывают в буффер просмотренного файла, поэтому копируются в общий буффер записи.
+    size_t text_size = 0;
+    for (const Searcher::Entry& entry : entries) { text_size += entry.line.size(); }
+    Record record{stamp.mtime, stamp.size, 0, true, entries, std::unique_ptr<char[]>(new char[text_size])};
+    char* text = record.text.get();
+    for (Searcher::Entry& entry : record.entries)
+    {
+        std::memcpy(text, entry.line.data(), entry.line.size());
+        entry.line = std::string_view(text, entry.line.size());
+        text += entry.line.size();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_records);
+    records[Key{stamp.device, stamp.inode}] = std::move(record);
+    modified = true;
+}
+
+bool ResultCache::save()
+{
+    std::unique_lock<std::mutex> lock(mutex_records);
+    if (!modified) { return true; }
+
+    // Формат записи: хэш сигнатуры, устройство, индексный дескриптор, время изменения, размер, возраст,
+    // размер данных, данные (число строк и строки с номерами, числом вхождений и образцами).
+    std::string data(cache_magic, sizeof(cache_magic));
+    data += other_records;
+    std::string payload;
+    for (const auto& [key, record] : records)
+    {
+        const uint32_t age = record.used ? 0 : record.age + 1;
+        if (age > max_age) { continue; }
+        payload.clear();
+        append_value<uint32_t>(payload, record.entries.size());
+        for (const Searcher::Entry& entry : record.entries)
+        {
+            append_value<uint64_t>(payload, entry.line_number);
+            append_value<uint32_t>(payload, entry.entries_number);
+            append_value<uint32_t>(payload, entry.patterns.size());
+            for (uint32_t pattern : entry.patterns) { append_value<uint32_t>(payload, pattern); }
+            append_value<uint64_t>(payload, entry.line.size());
+            payload += entry.line;
+        }
+
+        append_value<uint64_t>(data, signature_hash);
+        append_value<uint64_t>(data, key.device);
+        append_value<uint64_t>(data, key.inode);
+        append_value<int64_t>(data, record.mtime);
+        append_value<uint64_t>(data, record.size);
+        append_value<uint32_t>(data, age);
+        append_value<uint64_t>(data, payload.size());
+        data += payload;
+    }
+
+    // Кэш записывается в уникальный временный файл той же директории и заменяет прежний атомарно:
+    // одновременные запуски не пишут в один временный файл, и читатели видят только целый кэш.
+    std::string temporary_path = path.string() + ".XXXXXX";
+    const int descriptor = mkostemp(temporary_path.data(), O_CLOEXEC);
+    if (descriptor < 0) { return false; }
+
+    // mkostemp создаёт файл с правами 0600; кэш получает обычные права новых файлов (0666 без umask).
+    const mode_t mask = umask(0);
+    umask(mask);
+    bool written = !fchmod(descriptor, 0666 & ~mask);
+    for (size_t offset = 0; written && offset < data.size();)
+    {
+        const ssize_t count = write(descriptor, data.data() + offset, data.size() - offset);
+        if (count < 0 && errno == EINTR) { continue; }
+        written = count > 0;
+        if (written) { offset += count; }
+    }
+    written = !close(descriptor) && written;
+
+    std::error_code error;
+    if (written) { std::filesystem::rename(temporary_path, path, error); }
+    if (!written || error)
+    {
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    modified = false;
+    return true;
+}
+
+// PROTECTED:
+void ResultCache::load()
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) { return; }
+    contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (contents.size() < sizeof(cache_magic) || std::memcmp(contents.data(), cache_magic, sizeof(cache_magic))) { return; }
+
+    // Повреждённый конец файла отбрасывается.
+    const char* position = contents.data() + sizeof(cache_magic);
+    const char* end = contents.data() + contents.size();
+    while (position < end)
+    {
+        const char* record_begin = position;
+        uint64_t signature, device, inode, size, payload_size;
+        int64_t mtime;
+        uint32_t age;
+        if (!read_value(position, end, signature) || !read_value(position, end, device) ||
+            !read_value(position, end, inode) || !read_value(position, end, mtime) ||
+            !read_value(position, end, size) || !read_value(position, end, age) ||
+            !read_value(position, end, payload_size) || payload_size > static_cast<uint64_t>(end - position))
+        { break; }
+
+        // Записи других запросов при следующем сохранении становятся старше на одно сохранение.
+        const char* payload_end = position + payload_size;
+        if (signature != signature_hash)
+        {
+            if (age < max_age)
+            {
+                const size_t age_offset = other_records.size() + (position - record_begin) - sizeof(payload_size) - sizeof(age);
+                other_records.append(record_begin, payload_end);
+                ++age;
+                std::memcpy(other_records.data() + age_offset, &age, sizeof(age));
+            }
+            position = payload_end;
+            continue;
+        }
+
+        Record record{mtime, size, age, false, {}, nullptr};
+        uint32_t entries_number = 0;
+        bool valid = read_value(position, payload_end, entries_number);
+        for (uint32_t i = 0; valid && i < entries_number; ++i)
+        {
+            Searcher::Entry entry;
+            uint32_t patterns_number = 0;
+            uint64_t line_size = 0;
+            valid = read_value(position, payload_end, entry.line_number) &&
+                    read_value(position, payload_end, entry.entries_number) &&
+                    read_value(position, payload_end, patterns_number);
+            for (uint32_t j = 0; valid && j < patterns_number; ++j)
+            {
+                uint32_t pattern = 0;
+                valid = read_value(position, payload_end, pattern);
+                if (valid) { entry.patterns.push_back(pattern); }
+            }
+            valid = valid && read_value(position, payload_end, line_size) && line_size <= static_cast<uint64_t>(payload_end - position);
+            if (!valid) { break; }
+            entry.line = std::string_view(position, line_size);
+            position += line_size;
+            record.entries.push_back(std::move(entry));
+        }
+        if (valid) { records[Key{device, inode}] = std::move(record); }
+        position = payload_end;
+    }
+}
+
+// PRIVATE:
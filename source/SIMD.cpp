@@ -0,0 +1,245 @@
+#include "SIMD.hpp"
+#include "CaseFold.hpp"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PSEARCH_SIMD_X86
+#endif
+
+// Оценка частоты байта в типичных текстовых данных: чем больше значение, тем чаще встречается байт.
+static unsigned byte_rank(unsigned char byte)
+{
+    static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+    static const char punctuation[] = ".,:;/-_=()'\"<>[]{}";
+
+    if (byte == ' ') { return 255; }
+    if (byte == '\n' || byte == '\t' || byte == '\r') { return 200; }
+    if (const void* letter = std::memchr(letters, byte, sizeof(letters) - 1))
+    { return 250 - 4 * (static_cast<const char*>(letter) - letters); }
+    if (const void* letter = std::memchr(letters, byte - 'A' + 'a', sizeof(letters) - 1); letter && byte >= 'A' && byte <= 'Z')
+    { return 130 - 2 * (static_cast<const char*>(letter) - letters); }
+    if (byte >= '0' && byte <= '9') { return 140; }
+    if (std::memchr(punctuation, byte, sizeof(punctuation) - 1)) { return 120; }
+    if (byte == 0) { return 110; }
+    if (byte == 0xD0 || byte == 0xD1) { return 100; } // Первые байты кириллицы в UTF-8.
+    if (byte >= 0x80 && byte <= 0xBF) { return 90; }  // Продолжения многобайтовых символов UTF-8.
+    if (byte > 0x20 && byte < 0x7F) { return 60; }
+    if (byte >= 0x80) { return 40; }
+    return 20;
+}
+
+// Сравнение кандидата с образцом. Без учёта регистра образец хранится в нижнем регистре.
+template <bool fold>
+static bool equal(const char* candidate, const std::string& pattern)
+{
+    if (!fold) { return std::memcmp(candidate, pattern.data(), pattern.size()) == 0; }
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        if (CaseFold::fold_ascii(candidate[i]) != static_cast<unsigned char>(pattern[i])) { return false; }
+    }
+    return true;
+}
+
+// Скалярный поиск: memchr по самому редкому байту (без учёта регистра - побайтовое сравнение) и проверка кандидата.
+template <bool fold>
+static const char* find_scalar(const char* begin, const char* end, const std::string& pattern, size_t first_offset)
+{
+    const size_t size = pattern.size();
+    if (static_cast<size_t>(end - begin) < size) { return end; }
+
+    const char* last = end - size; // Последняя допустимая позиция начала вхождения.
+    const char* iter = begin;
+    while (iter <= last)
+    {
+        const char* candidate;
+        if (fold)
+        {
+            const unsigned char first_byte = pattern[first_offset];
+            candidate = iter;
+            while (candidate <= last && CaseFold::fold_ascii(candidate[first_offset]) != first_byte) { ++candidate; }
+            if (candidate > last) { break; }
+        }
+        else
+        {
+            const void* hit = std::memchr(iter + first_offset, pattern[first_offset], last - iter + 1);
+            if (!hit) { break; }
+            candidate = static_cast<const char*>(hit) - first_offset;
+        }
+
+        if (equal<fold>(candidate, pattern)) { return candidate; }
+        iter = candidate + 1;
+    }
+    return end;
+}
+
+#ifdef PSEARCH_SIMD_X86
+// Векторный поиск, 16 позиций за итерацию. Без учёта регистра у букв устанавливается бит 0x20
+// (у остальных байтов фильтра блок не изменяется).
+template <bool fold>
+__attribute__((target("sse2")))
+static const char* find_sse2(const char* begin, const char* end, const std::string& pattern, size_t first_offset, size_t second_offset)
+{
+    const size_t size = pattern.size();
+    const __m128i first_byte = _mm_set1_epi8(pattern[first_offset]);
+    const __m128i second_byte = _mm_set1_epi8(pattern[second_offset]);
+    const __m128i first_case = _mm_set1_epi8(fold && CaseFold::is_ascii_letter(pattern[first_offset]) ? 0x20 : 0);
+    const __m128i second_case = _mm_set1_epi8(fold && CaseFold::is_ascii_letter(pattern[second_offset]) ? 0x20 : 0);
+
+    // Цикл выполняется, пока все 16 кандидатов целиком помещаются в диапазон.
+    const char* iter = begin;
+    while (static_cast<size_t>(end - iter) >= size + 15)
+    {
+        __m128i first_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iter + first_offset));
+        __m128i second_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iter + second_offset));
+        if (fold)
+        {
+            first_block = _mm_or_si128(first_block, first_case);
+            second_block = _mm_or_si128(second_block, second_case);
+        }
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first_block, first_byte), _mm_cmpeq_epi8(second_block, second_byte)));
+        while (mask)
+        {
+            const char* candidate = iter + __builtin_ctz(mask);
+            if (equal<fold>(candidate, pattern)) { return candidate; }
+            mask &= mask - 1;
+        }
+        iter += 16;
+    }
+    return find_scalar<fold>(iter, end, pattern, first_offset);
+}
+
+// Векторный поиск, 32 позиции за итерацию.
+template <bool fold>
+__attribute__((target("avx2")))
+static const char* find_avx2(const char* begin, const char* end, const std::string& pattern, size_t first_offset, size_t second_offset)
+{
+    const size_t size = pattern.size();
+    const __m256i first_byte = _mm256_set1_epi8(pattern[first_offset]);
+    const __m256i second_byte = _mm256_set1_epi8(pattern[second_offset]);
+    const __m256i first_case = _mm256_set1_epi8(fold && CaseFold::is_ascii_letter(pattern[first_offset]) ? 0x20 : 0);
+    const __m256i second_case = _mm256_set1_epi8(fold && CaseFold::is_ascii_letter(pattern[second_offset]) ? 0x20 : 0);
+
+    // Цикл выполняется, пока все 32 кандидата целиком помещаются в диапазон.
+    const char* iter = begin;
+    while (static_cast<size_t>(end - iter) >= size + 31)
+    {
+        __m256i first_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter + first_offset));
+        __m256i second_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter + second_offset));
+        if (fold)
+        {
+            first_block = _mm256_or_si256(first_block, first_case);
+            second_block = _mm256_or_si256(second_block, second_case);
+        }
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first_block, first_byte), _mm256_cmpeq_epi8(second_block, second_byte)));
+        while (mask)
+        {
+            const char* candidate = iter + __builtin_ctz(mask);
+            if (equal<fold>(candidate, pattern)) { return candidate; }
+            mask &= mask - 1;
+        }
+        iter += 32;
+    }
+    return find_sse2<fold>(iter, end, pattern, first_offset, second_offset);
+}
+#endif
+
+////////////////      SIMD      ////////////////
+// Класс, реализующий поиск подстроки с векторной фильтрацией кандидатов.
+// PUBLIC:
+SIMD::SIMD(const std::string& init_string) : SIMD(init_string, best_kernel())
+{}
+
+SIMD::SIMD(const std::string& init_string, Kernel init_kernel, bool init_case_insensitive)
+{
+    pattern = init_string;
+    kernel = init_kernel;
+    case_insensitive = init_case_insensitive;
+    if (case_insensitive)
+    {
+        for (char& ch : pattern) { ch = CaseFold::fold_ascii(ch); }
+    }
+    choose_offsets();
+}
+
+void SIMD::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    LineTracker lines(begin, end, entries, limits);
+
+    // Вхождения могут перекрываться, поэтому поиск продолжается со следующей позиции.
+    const char* iter = begin;
+    while (true)
+    {
+        const char* found = find(iter, end);
+        if (found == end) { break; }
+        lines.add(found + pattern.size() - 1);
+        if (lines.full()) { break; }
+        iter = found + 1;
+    }
+}
+
+const char* SIMD::find(const char* begin, const char* end) const
+{
+    if (case_insensitive)
+    {
+        switch (kernel)
+        {
+            #ifdef PSEARCH_SIMD_X86
+            case Kernel::avx2: { return find_avx2<true>(begin, end, pattern, first_offset, second_offset); }
+            case Kernel::sse2: { return find_sse2<true>(begin, end, pattern, first_offset, second_offset); }
+            #endif
+            default: { return find_scalar<true>(begin, end, pattern, first_offset); }
+        }
+    }
+
+    switch (kernel)
+    {
+        #ifdef PSEARCH_SIMD_X86
+        case Kernel::avx2: { return find_avx2<false>(begin, end, pattern, first_offset, second_offset); }
+        case Kernel::sse2: { return find_sse2<false>(begin, end, pattern, first_offset, second_offset); }
+        #endif
+        default: { return find_scalar<false>(begin, end, pattern, first_offset); }
+    }
+}
+
+SIMD::Kernel SIMD::best_kernel()
+{
+    static const Kernel kernel = []()
+    {
+        #ifdef PSEARCH_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { return Kernel::avx2; }
+        if (__builtin_cpu_supports("sse2")) { return Kernel::sse2; }
+        #endif
+        return Kernel::scalar;
+    }();
+    return kernel;
+}
+
+// PROTECTED:
+void SIMD::choose_offsets()
+{
+    // Выбор двух самых редких байтов образца. Второй байт по возможности отличается от первого,
+    // чтобы фильтр отсекал больше позиций.
+    first_offset = 0;
+    for (size_t i = 1; i < pattern.size(); ++i)
+    {
+        if (byte_rank(pattern[i]) < byte_rank(pattern[first_offset])) { first_offset = i; }
+    }
+
+    second_offset = first_offset;
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        if (i == first_offset) { continue; }
+        if (second_offset == first_offset) { second_offset = i; continue; }
+
+        const bool distinct = (pattern[i] != pattern[first_offset]);
+        const bool second_distinct = (pattern[second_offset] != pattern[first_offset]);
+        if ((distinct && !second_distinct) ||
+            (distinct == second_distinct && byte_rank(pattern[i]) < byte_rank(pattern[second_offset])))
+        { second_offset = i; }
+    }
+}
+
+// PRIVATE:
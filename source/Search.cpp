@@ -0,0 +1,89 @@
+#include "Search.hpp"
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+
+////////////////     Search     ////////////////
+// Точка входа библиотеки libpsearch.
+// PUBLIC:
+Search::Search(const Options& init_options)
+{
+    options = init_options;
+    options.threads_number = std::max<size_t>(options.threads_number, 1);
+
+    // Объект поиска: автомат Ахо-Корасик для набора образцов, ленивый ДКА для регулярного выражения или
+    // выбранный по образцу алгоритм для одного образца. При самопроверке результат каждого диапазона
+    // сравнивается с результатом другого алгоритма.
+    engine_name = Engine::choose(options.query);
+    searcher = Engine::create(options.query);
+    if (!options.check_engine.empty())
+    {
+        Engine::Query check_query = options.query;
+        check_query.engine = options.check_engine;
+        std::shared_ptr<Searcher> check_searcher = Engine::create(check_query);
+        const std::string check_name = Engine::choose(check_query);
+        if (check_name == engine_name)
+        { throw std::invalid_argument("алгоритм самопроверки совпадает с основным (" + engine_name + "), сравнение ничего не проверяет"); }
+        searcher = std::make_shared<Crosscheck>(searcher, check_searcher, engine_name, check_name);
+    }
+
+    // При выводе только файлов поиск в файле прекращается на первой строке с вхождением, а границы
+    // и номера строк не определяются, если выводятся только файлы или число строк.
+    Searcher::Limits limits;
+    limits.max_lines = (options.mode == Output::Mode::files) ? 1 : options.max_lines;
+    limits.copy_lines = (options.mode == Output::Mode::lines);
+    searcher->set_limits(limits);
+}
+
+void Search::run(const std::filesystem::path& path, std::shared_ptr<Output> output)
+{
+    run_walker(path, output);
+}
+
+void Search::run(const std::vector<std::filesystem::path>& paths, std::shared_ptr<Output> output)
+{
+    run_walker(paths, output);
+}
+
+void Search::run(const std::filesystem::path& path, const Output::Callback& callback)
+{
+    run_walker(path, std::make_shared<Output>(callback, options.mode));
+}
+
+void Search::cancel()
+{
+    std::unique_lock<std::mutex> lock(mutex_walker);
+    cancelled = true;
+    if (walker) { walker->cancel(); }
+}
+
+// PROTECTED:
+template <typename Target>
+void Search::run_walker(const Target& target, std::shared_ptr<Output> output)
+{
+    if (!cancelled)
+    {
+        Walker current_walker(searcher, output, options.threads_number, options.walker);
+        if constexpr (std::is_same<Target, std::filesystem::path>::value) { current_walker.walk(target, options.recursively); }
+        else { current_walker.walk(target); }
+
+        // Отмена, запрошенная до регистрации обхода, применяется сразу.
+        {
+            std::unique_lock<std::mutex> lock(mutex_walker);
+            walker = &current_walker;
+            if (cancelled) { current_walker.cancel(); }
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < options.threads_number; ++i)
+        { threads.push_back(std::thread(&Walker::search, std::ref(current_walker), i)); }
+        for (std::thread& thread : threads) { thread.join(); }
+
+        std::unique_lock<std::mutex> lock(mutex_walker);
+        walker = nullptr;
+    }
+    output->finish();
+}
+
+// PRIVATE:
@@ -1,20 +1,77 @@
 #include "Searcher.hpp"
+#include "CaseFold.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 //#define DEBUG_OUTPUT_SEARCHER_SEARCH
 
+////////////////    Searcher    ////////////////
+// Класс-интерфейс для всех объектов, предоставляющих функциональность поиска.
+// PUBLIC:
+// PROTECTED:
+Searcher::LineTracker::LineTracker(const char* init_begin, const char* init_end, std::vector<Entry>& init_entries, const Limits& init_limits) :
+    begin(init_begin), end(init_end), line_begin(init_begin), line_end(init_begin),
+    max_lines(init_limits.max_lines ? init_limits.max_lines : SIZE_MAX), copy_lines(init_limits.copy_lines), entries(init_entries)
+{}
+
+void Searcher::LineTracker::add_line(const char* position)
+{
+    // Подсчёт переводов строки только между предыдущей найденной строкой и вхождением.
+    if (copy_lines) { line_number += std::count(line_begin, position, '\n'); }
+    ++lines_found;
+
+    // Поиск границ строки, содержащей вхождение.
+    const void* previous = memrchr(line_begin, '\n', position - line_begin);
+    if (previous) { line_begin = static_cast<const char*>(previous) + 1; }
+
+    const void* next = std::memchr(position, '\n', end - position);
+    const char* line_last = next ? static_cast<const char*>(next) : end;
+    line_end = next ? line_last + 1 : end;
+
+    // Границы строки нужны только для вывода.
+    if (copy_lines) { entries.push_back(Entry{line_number, std::string_view(line_begin, line_last - line_begin), 1, {}}); }
+    else { entries.push_back(Entry{line_number, std::string_view(), 1, {}}); }
+
+    #ifdef DEBUG_OUTPUT_SEARCHER_SEARCH
+    std::cout << "Line:" << line_number << std::endl;
+    #endif
+}
+
+// PRIVATE:
+
+
 ////////////////       KMP       ///////////////
 // Класс, реализующий автомат Кнута-Морриса-Пратта.
 // PUBLIC:
-KMP::KMP(const std::string& init_string)
+KMP::KMP(const std::string& init_string, bool init_case_insensitive)
 {
     pattern = init_string;
-
-    // Создание в куче пустого вектора для автомата.
+    case_insensitive = init_case_insensitive;
+    if (case_insensitive)
+    {
+        for (char& ch : pattern) { ch = CaseFold::fold_ascii(ch); }
+    }
     const size_t str_size = pattern.size();
-    const size_t char_size = (sizeof(char) << 8);
-    const size_t kmp_size = (str_size + 1) * char_size;
-    states_table = std::vector<size_t>(kmp_size, 0);
+
+    // Разбиение байт на классы эквивалентности: каждый встречающийся в образце байт образует
+    // собственный класс, остальные байты (если есть) попадают в общий класс 0.
+    std::array<bool, 256> present = {};
+    for (char ch : pattern) { present[static_cast<unsigned char>(ch)] = true; }
+    const bool has_other = std::count(present.begin(), present.end(), true) < 256;
+    classes_number = has_other ? 1 : 0;
+    for (size_t byte = 0; byte < 256; ++byte)
+    { byte_classes[byte] = present[byte] ? classes_number++ : 0; }
+
+    // Без учёта регистра заглавные буквы попадают в классы строчных (представителем класса остаётся строчная).
+    if (case_insensitive)
+    {
+        for (size_t byte = 'A'; byte <= 'Z'; ++byte) { byte_classes[byte] = byte_classes[CaseFold::fold_ascii(byte)]; }
+    }
+
+    // Строки таблицы выравниваются до степени двойки, чтобы индекс вычислялся сдвигом.
+    classes_shift = 0;
+    while ((static_cast<size_t>(1) << classes_shift) < classes_number) { ++classes_shift; }
 
     // Предвычисление префикс-функции для данной строки.
     std::vector<size_t> pi(str_size, 0);
@@ -28,12 +85,37 @@ KMP::KMP(const std::string& init_string)
         pi[i] = j;
     }
 
-    // Вычисление перехода для каждого состояния, кроме последнего, и символа.
+    // Выбор наименьшего типа, вмещающего номера всех (str_size + 1) состояний.
+    if (str_size <= UINT8_MAX) { build<uint8_t>(pi); }
+    else if (str_size <= UINT16_MAX) { build<uint16_t>(pi); }
+    else { build<uint32_t>(pi); }
+}
+
+void KMP::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    std::visit([&](const auto& table) { search_table(table, begin, end, entries); }, states_table);
+}
+
+// PROTECTED:
+template <typename State>
+void KMP::build(const std::vector<size_t>& pi)
+{
+    // Создание в куче пустой таблицы для автомата.
+    const size_t str_size = pattern.size();
+    Table<State> table((str_size + 1) << classes_shift, 0);
+
+    // Представитель каждого класса (для общего класса - любой не встречающийся в образце байт).
+    std::vector<char> representatives(classes_number, 0);
+    for (size_t byte = 0; byte < 256; ++byte)
+    { representatives[byte_classes[byte]] = static_cast<char>(byte); }
+
+    // Вычисление перехода для каждого состояния, кроме последнего, и класса символов.
     for (size_t state = 0; state < str_size; ++state)
     {
-        for (char ch = 0; static_cast<size_t>(static_cast<unsigned char>(ch)) < 255; ++ch)
+        for (size_t ch_class = 0; ch_class < classes_number; ++ch_class)
         {
             // Вычисление перехода по префикс-функции.
+            const char ch = representatives[ch_class];
             size_t next_state = state;
             while (true)
             {
@@ -44,61 +126,43 @@ KMP::KMP(const std::string& init_string)
             }
 
             // Запись в таблицу.
-            states_table[state * char_size + static_cast<size_t>(static_cast<unsigned char>(ch))] = next_state;
+            table[(state << classes_shift) + ch_class] = static_cast<State>(next_state);
         }
     }
 
-    for (char ch = 0; static_cast<size_t>(static_cast<unsigned char>(ch)) < 255; ++ch)
+    // Переходы из конечного состояния совпадают с переходами из состояния, соответствующего
+    // наибольшему собственному бордеру образца (это позволяет находить перекрывающиеся вхождения).
+    if (str_size)
     {
-        // Вычисление перехода по префикс-функции.
-        size_t next_state = str_size;
-        while (true)
-        {
-            if (next_state) { next_state = pi[next_state - 1]; }
-            else { break; }
-        }
-
-        // Запись в таблицу.
-        states_table[str_size * char_size + static_cast<size_t>(static_cast<unsigned char>(ch))] = next_state;
+        const size_t border = pi[str_size - 1];
+        for (size_t ch_class = 0; ch_class < classes_number; ++ch_class)
+        { table[(str_size << classes_shift) + ch_class] = table[(border << classes_shift) + ch_class]; }
     }
+
+    states_table = std::move(table);
 }
 
-void KMP::search(std::istream& stream, std::vector<Searcher::Entry>& entries) const
+template <typename State>
+void KMP::search_table(const Table<State>& table, const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
 {
     // Некоторые константы.
-    const size_t char_size = (sizeof(char) << 8);
-    const size_t str_size = pattern.size();
+    const State final_state = static_cast<State>(pattern.size());
+    const size_t shift = classes_shift;
 
     // Вспомогательные переменные.
-    size_t state = 0; // Текущее состояние автомата.
+    size_t state = 0;                               // Текущее состояние автомата.
+    LineTracker lines(begin, end, entries, limits); // Границы и номера строк определяются только для вхождений.
 
-    // Структура для сохранения информации о вхождении.
-    Searcher::Entry entry;
-    entry.line_number = 0;
-    entry.entries_number = 0;
-
-    // Цикл поиска.
-    while(std::getline(stream, entry.line))
+    // Цикл поиска. Символы перевода строки также проходят через автомат, сбрасывая его состояние.
+    for (const char* iter = begin; iter != end; ++iter)
     {
-        for (size_t i = 0; i < entry.line.size(); ++i)
+        state = table[(state << shift) + byte_classes[static_cast<unsigned char>(*iter)]];
+        if (state == final_state)
         {
-            state = states_table[state * char_size + static_cast<size_t>(static_cast<unsigned char>(entry.line[i]))];
-            if (state == str_size)
-            { ++entry.entries_number; }
-            //entry.entries_number += (state == str_size);
+            lines.add(iter);
+            if (lines.full()) { break; }
         }
-
-        if (entry.entries_number) { entries.push_back(entry); }
-        entry.entries_number = 0;
-        ++entry.line_number;
-        entry.line.clear();
-
-        #ifdef DEBUG_OUTPUT_SEARCHER_SEARCH
-        std::cout << "Line:" << entry.line_number << std::endl;
-        #endif
     }
 }
 
-// PROTECTED:
-
 // PRIVATE:
@@ -0,0 +1,494 @@
+#include "Server.hpp"
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "Output.hpp"
+#include "Engine.hpp"
+
+// Запись всего буффера в дескриптор.
+static bool write_all(int descriptor, const char* data, size_t size)
+{
+    while (size)
+    {
+        ssize_t written = write(descriptor, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Заполнение адреса Unix domain socket. Возвращает false, если путь слишком длинный.
+static bool make_address(const std::filesystem::path& socket_path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.native().size() >= sizeof(address.sun_path)) { return false; }
+    std::strcpy(address.sun_path, socket_path.c_str());
+    return true;
+}
+
+//////////////// Server::Request ////////////////
+// Запрос клиента. Передаётся как последовательность строк "ключ=значение", каждая из которых
+// завершается нулевым байтом; конец запроса - пустая строка.
+// PUBLIC:
+std::string Server::Request::serialize() const
+{
+    std::string message;
+    auto add = [&message](const std::string& key, const std::string& value)
+    {
+        message += key;
+        message.push_back('=');
+        message += value;
+        message.push_back('\0');
+    };
+
+    add("pattern", pattern);
+    for (const std::string& item : patterns) { add("patterns", item); }
+    add("engine", engine);
+    add("regex", regex ? "1" : "0");
+    add("case", case_insensitive ? "1" : "0");
+    add("sorted", sorted ? "1" : "0");
+    add("chunk", std::to_string(chunk_size));
+    add("mode", std::to_string(static_cast<int>(mode)));
+    add("max_lines", std::to_string(max_lines));
+    add("max_results", std::to_string(max_results));
+    message.push_back('\0');
+    return message;
+}
+
+bool Server::Request::parse(const std::string& message)
+{
+    size_t position = 0;
+    while (position < message.size())
+    {
+        const size_t end = message.find('\0', position);
+        if (end == std::string::npos) { return false; }
+        if (end == position) { return true; }
+
+        const std::string field = message.substr(position, end - position);
+        position = end + 1;
+        const size_t separator = field.find('=');
+        if (separator == std::string::npos) { return false; }
+        const std::string key = field.substr(0, separator);
+        const std::string value = field.substr(separator + 1);
+
+        if (key == "pattern") { pattern = value; }
+        else if (key == "patterns") { patterns.push_back(value); }
+        else if (key == "engine") { engine = value; }
+        else if (key == "regex") { regex = (value == "1"); }
+        else if (key == "case") { case_insensitive = (value == "1"); }
+        else if (key == "sorted") { sorted = (value == "1"); }
+        else if (key == "chunk" || key == "mode" || key == "max_lines" || key == "max_results")
+        {
+            uintmax_t number;
+            try { number = std::stoull(value); }
+            catch (const std::logic_error& exception) { return false; }
+
+            if (key == "chunk") { chunk_size = number; }
+            else if (key == "mode")
+            {
+                if (number > static_cast<uintmax_t>(Output::Mode::counts)) { return false; }
+                mode = static_cast<Output::Mode>(number);
+            }
+            else if (key == "max_lines") { max_lines = number; }
+            else { max_results = number; }
+        }
+        else { return false; }
+    }
+    return false;
+}
+
+// PROTECTED:
+
+// PRIVATE:
+
+
+////////////////     Server     ////////////////
+// Резидентный режим поиска.
+// PUBLIC:
+const uint32_t Server::watch_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR;
+
+Server::Server(const std::filesystem::path& init_root, bool init_recursively, size_t init_threads_number, const Walker::Options& init_options)
+{
+    root = std::filesystem::absolute(init_root).lexically_normal();
+    if (!root.has_filename() && root != root.root_path()) { root = root.parent_path(); }
+    recursively = init_recursively;
+    threads_number = std::max<size_t>(init_threads_number, 1);
+    options = init_options;
+
+    // Наблюдения устанавливаются до чтения директорий, поэтому файлы, созданные во время начального
+    // обхода, не теряются.
+    inotify_descriptor = inotify_init1(IN_CLOEXEC);
+    scan(root, options.filter ? options.filter->root(root.native()) : nullptr);
+    if (inotify_descriptor >= 0 && !pipe2(stop_pipe, O_CLOEXEC)) { watcher = std::thread(&Server::watch_loop, this); }
+
+    for (size_t i = 0; i < threads_number; ++i) { pool.push_back(std::thread(&Server::pool_loop, this, i)); }
+}
+
+Server::~Server()
+{
+    // Пул останавливается после закрытия всех соединений.
+    {
+        std::unique_lock<std::mutex> lock(mutex_clients);
+        condition_clients.wait(lock, [this]() { return !clients; });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_pool);
+        stopping = true;
+    }
+    condition_pool.notify_all();
+    for (auto& thread : pool) { thread.join(); }
+
+    // Запись в канал прерывает ожидание событий inotify.
+    if (watcher.joinable())
+    {
+        write_all(stop_pipe[1], "", 1);
+        watcher.join();
+        close(stop_pipe[0]);
+        close(stop_pipe[1]);
+    }
+    if (inotify_descriptor >= 0) { close(inotify_descriptor); }
+}
+
+bool Server::serve(const std::filesystem::path& socket_path)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path, address)) { return false; }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) { return false; }
+    unlink(socket_path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) || listen(listener, 16))
+    {
+        close(listener);
+        return false;
+    }
+
+    // Клиент может отключиться до окончания вывода: ошибки записи обрабатываются вместо сигнала.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Каждое соединение обслуживается отдельным потоком, поэтому чтение запроса не задерживает приём
+    // следующих соединений.
+    while (true)
+    {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) { continue; }
+            break;
+        }
+
+        { std::unique_lock<std::mutex> lock(mutex_clients); ++clients; }
+        std::thread([this, client]()
+        {
+            handle(client);
+            close(client);
+            std::unique_lock<std::mutex> lock(mutex_clients);
+            if (!--clients) { condition_clients.notify_all(); }
+        }).detach();
+    }
+    close(listener);
+    return true;
+}
+
+int Server::query(const std::filesystem::path& socket_path, const Request& request, int output_descriptor)
+{
+    sockaddr_un address;
+    int server = -1;
+    if (make_address(socket_path, address)) { server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0); }
+    if (server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+    {
+        std::cerr << "Не удалось подключиться к серверу: " << socket_path << std::endl;
+        if (server >= 0) { close(server); }
+        return 1;
+    }
+
+    const std::string message = request.serialize();
+    write_all(server, message.data(), message.size());
+    shutdown(server, SHUT_WR);
+
+    // Первый байт ответа - признак успеха; при ошибке далее следует её описание.
+    char status = 0;
+    ssize_t count;
+    do { count = read(server, &status, 1); } while (count < 0 && errno == EINTR);
+
+    int result = (count == 1 && status == 'O') ? 0 : 1;
+    const int target = result ? STDERR_FILENO : output_descriptor;
+    char buffer[64 * 1024];
+    while (true)
+    {
+        count = read(server, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+        if (!write_all(target, buffer, count)) { break; }
+    }
+    close(server);
+    return result;
+}
+
+// PROTECTED:
+void Server::scan(const std::filesystem::path& directory, const std::shared_ptr<const Filter::Ignore>& parent)
+{
+    // Правила .gitignore и .ignore директории дополняют правила родительских директорий.
+    const Filter* filter = options.filter.get();
+    std::shared_ptr<const Filter::Ignore> ignore = parent;
+    if (filter)
+    {
+        int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (descriptor < 0) { return; }
+        ignore = filter->enter(directory.native(), descriptor, parent);
+        close(descriptor);
+    }
+    add_watch(directory, parent, ignore);
+
+    std::vector<std::string> found;
+    std::error_code error;
+    const auto directory_options = std::filesystem::directory_options::skip_permission_denied;
+    for (auto iter = std::filesystem::directory_iterator(directory, directory_options, error);
+         !error && iter != std::filesystem::directory_iterator(); iter.increment(error))
+    {
+        // Ссылки на обычные файлы обрабатываются, на директории - не обходятся.
+        std::error_code status_error;
+        const bool is_directory = !iter->is_symlink(status_error) && iter->is_directory(status_error);
+        if (!is_directory && !iter->is_regular_file(status_error)) { continue; }
+        if (is_directory && !recursively) { continue; }
+        if (filter && !filter->allows(iter->path().native(), iter->path().filename().c_str(), is_directory, *ignore)) { continue; }
+
+        if (is_directory) { scan(iter->path(), ignore); }
+        else { found.push_back(iter->path().string()); }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_files);
+    files.insert(found.begin(), found.end());
+}
+
+void Server::add_watch(const std::filesystem::path& directory, const std::shared_ptr<const Filter::Ignore>& parent,
+                       const std::shared_ptr<const Filter::Ignore>& ignore)
+{
+    if (inotify_descriptor < 0) { return; }
+    int watch = inotify_add_watch(inotify_descriptor, directory.c_str(), watch_mask);
+    if (watch < 0) { return; }
+
+    std::unique_lock<std::mutex> lock(mutex_files);
+    watches[watch] = Watch{directory.string(), parent, ignore};
+}
+
+void Server::remove_subtree(const std::string& directory)
+{
+    const std::string prefix = directory + "/";
+    std::unique_lock<std::mutex> lock(mutex_files);
+    for (auto iter = files.lower_bound(prefix); iter != files.end() && iter->compare(0, prefix.size(), prefix) == 0;)
+    { iter = files.erase(iter); }
+    for (auto iter = watches.begin(); iter != watches.end();)
+    {
+        if (iter->second.path == directory || iter->second.path.compare(0, prefix.size(), prefix) == 0)
+        {
+            inotify_rm_watch(inotify_descriptor, iter->first);
+            iter = watches.erase(iter);
+        }
+        else { ++iter; }
+    }
+}
+
+void Server::watch_loop()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    const int descriptor = inotify_descriptor;
+    const Filter* filter = options.filter.get();
+    while (true)
+    {
+        pollfd descriptors[2] = {{descriptor, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+        if (poll(descriptors, 2, -1) < 0)
+        {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        if (descriptors[1].revents) { break; }
+
+        ssize_t count = read(descriptor, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+
+        for (ssize_t offset = 0; offset < count;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            // При переполнении очереди событий список файлов строится заново.
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_files);
+                    files.clear();
+                    for (const auto& watch : watches) { inotify_rm_watch(descriptor, watch.first); }
+                    watches.clear();
+                }
+                scan(root, filter ? filter->root(root.native()) : nullptr);
+                continue;
+            }
+
+            Watch watch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_files);
+                auto found = watches.find(event->wd);
+                if (found == watches.end()) { continue; }
+                if (event->mask & IN_IGNORED) { watches.erase(found); continue; }
+                watch = found->second;
+            }
+            if (!event->len) { continue; }
+            const std::string path = watch.path + "/" + event->name;
+
+            // При изменении файла правил поддерево директории строится заново.
+            if (filter && filter->get_options().ignore_files && (!std::strcmp(event->name, ".gitignore") || !std::strcmp(event->name, ".ignore")))
+            {
+                remove_subtree(watch.path);
+                scan(watch.path, watch.parent);
+                continue;
+            }
+
+            const bool is_directory = event->mask & IN_ISDIR;
+            if (filter && !filter->allows(path, event->name, is_directory, *watch.ignore)) { continue; }
+            if (is_directory)
+            {
+                if (event->mask & (IN_DELETE | IN_MOVED_FROM)) { remove_subtree(path); }
+                else if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && recursively) { scan(path, watch.ignore); }
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                std::unique_lock<std::mutex> lock(mutex_files);
+                files.erase(path);
+            }
+            else if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE))
+            {
+                struct stat status;
+                if (stat(path.c_str(), &status) || !S_ISREG(status.st_mode)) { continue; }
+                std::unique_lock<std::mutex> lock(mutex_files);
+                files.insert(path);
+            }
+        }
+    }
+}
+
+void Server::pool_loop(size_t thread_index)
+{
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_pool);
+    while (true)
+    {
+        condition_pool.wait(lock, [this, seen]() { return stopping || generation != seen; });
+        if (stopping) { break; }
+        seen = generation;
+        Walker* walker = current;
+
+        lock.unlock();
+        walker->search(thread_index);
+        lock.lock();
+
+        if (!--running) { condition_done.notify_all(); }
+    }
+}
+
+void Server::run(Walker& walker)
+{
+    std::unique_lock<std::mutex> lock_run(mutex_run);
+    std::unique_lock<std::mutex> lock(mutex_pool);
+    current = &walker;
+    running = pool.size();
+    ++generation;
+    condition_pool.notify_all();
+    condition_done.wait(lock, [this]() { return !running; });
+    current = nullptr;
+}
+
+void Server::handle(int client)
+{
+    Request request;
+    auto fail = [client](const std::string& text)
+    {
+        const std::string response = "E" + text + "\n";
+        write_all(client, response.data(), response.size());
+    };
+    std::string message;
+    if (!read_request(client, message)) { fail("Запрос не получен за " + std::to_string(request_timeout / 1000) + " с."); return; }
+    if (!request.parse(message)) { fail("Неверный запрос."); return; }
+
+    // Создание объекта для поиска так же, как при поиске без сервера.
+    std::shared_ptr<Searcher> searcher;
+    Engine::Query query;
+    query.pattern = request.pattern;
+    query.patterns = request.patterns;
+    query.engine = request.engine;
+    query.regex = request.regex;
+    query.case_insensitive = request.case_insensitive;
+    try { searcher = Engine::create(query); }
+    catch (const std::logic_error& exception)
+    {
+        fail((request.patterns.empty() ? request.pattern : std::string("-f")) + " (" + exception.what() + ").");
+        return;
+    }
+
+    Searcher::Limits limits;
+    limits.max_lines = (request.mode == Output::Mode::files) ? 1 : request.max_lines;
+    limits.copy_lines = (request.mode == Output::Mode::lines);
+    searcher->set_limits(limits);
+
+    std::vector<std::filesystem::path> snapshot;
+    {
+        std::unique_lock<std::mutex> lock(mutex_files);
+        snapshot.assign(files.begin(), files.end());
+    }
+
+    // Пути выводятся относительно корня дерева.
+    write_all(client, "O", 1);
+    Walker::Options request_options = options;
+    request_options.chunk_size = request.chunk_size;
+    request_options.max_results = request.max_results;
+    request_options.strip_prefix = (root == root.root_path()) ? root.string() : root.string() + "/";
+    std::shared_ptr<Output> output = std::make_shared<Output>(client, request.sorted, request.mode);
+    {
+        Walker walker(searcher, output, pool.size(), request_options);
+        walker.walk(snapshot);
+        run(walker);
+    }
+    output->finish();
+}
+
+bool Server::read_request(int client, std::string& message)
+{
+    // Запрос читается до пустой строки или закрытия соединения клиентом, но не дольше request_timeout.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(request_timeout);
+    char buffer[4096];
+    while (message.size() < 2 || message.compare(message.size() - 2, 2, std::string(2, '\0')) != 0)
+    {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd descriptor = {client, POLLIN, 0};
+        const int ready = (left > 0) ? poll(&descriptor, 1, static_cast<int>(left)) : 0;
+        if (ready < 0 && errno == EINTR) { continue; }
+        if (ready <= 0) { return false; }
+
+        ssize_t count = read(client, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { break; }
+        message.append(buffer, count);
+    }
+    return true;
+}
+
+// PRIVATE:
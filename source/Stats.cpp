@@ -0,0 +1,94 @@
+#include "Stats.hpp"
+#include <iomanip>
+
+// Названия счётчиков и таймеров в выводе.
+static const char* const counter_names[Stats::counters_number] =
+{ "files", "chunks", "bytes", "directories", "stat_calls", "lines", "matches", "steals", "cache_hits", "filtered", "binary_files", "async_reads", "compressed" };
+static const char* const timer_names[Stats::timers_number] =
+{ "traversal", "io", "scan", "output", "queue_wait", "directory_lock" };
+
+// Вывод значений в виде полей объекта JSON.
+static void write_fields(std::ostream& stream, const uint64_t (&counters)[Stats::counters_number], const uint64_t (&timers)[Stats::timers_number])
+{
+    for (size_t i = 0; i < Stats::counters_number; ++i)
+    { stream << "\"" << counter_names[i] << "\": " << counters[i] << ", "; }
+    for (size_t i = 0; i < Stats::timers_number; ++i)
+    { stream << (i ? ", " : "") << "\"" << timer_names[i] << "_ms\": " << timers[i] / 1e6; }
+}
+
+////////////////     Stats      ////////////////
+// Счётчики и таймеры горячего пути поиска.
+// PUBLIC:
+Stats::Stats(size_t threads_number, const std::string& init_engine)
+{
+    engine = init_engine;
+    for (size_t i = 0; i < threads_number; ++i) { threads.push_back(std::make_unique<Thread>()); }
+    started = std::chrono::steady_clock::now();
+}
+
+void Stats::report(std::ostream& stream, bool per_thread) const
+{
+    uint64_t counters[counters_number];
+    uint64_t timers[timers_number];
+    sum(counters, timers);
+
+    // Скорость алгоритма поиска - по времени, проведённому непосредственно в поиске.
+    const double wall = elapsed();
+    const double scan_seconds = timers[scan] / 1e9;
+    stream << std::fixed << std::setprecision(3)
+           << "{\"engine\": \"" << engine << "\", \"threads\": " << threads.size() << ", \"wall_ms\": " << wall * 1e3 << ", ";
+    write_fields(stream, counters, timers);
+    stream << ", \"engine_bytes_per_s\": " << (scan_seconds > 0 ? counters[bytes] / scan_seconds : 0.0)
+           << ", \"bytes_per_s\": " << (wall > 0 ? counters[bytes] / wall : 0.0);
+
+    if (per_thread)
+    {
+        stream << ", \"per_thread\": [";
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            uint64_t thread_counters[counters_number];
+            uint64_t thread_timers[timers_number];
+            for (size_t j = 0; j < counters_number; ++j) { thread_counters[j] = threads[i]->counters[j].load(std::memory_order_relaxed); }
+            for (size_t j = 0; j < timers_number; ++j) { thread_timers[j] = threads[i]->timers[j].load(std::memory_order_relaxed); }
+            stream << (i ? ", " : "") << "{";
+            write_fields(stream, thread_counters, thread_timers);
+            stream << "}";
+        }
+        stream << "]";
+    }
+    stream << "}" << std::defaultfloat << std::endl;
+}
+
+void Stats::progress(std::ostream& stream) const
+{
+    uint64_t counters[counters_number];
+    uint64_t timers[timers_number];
+    sum(counters, timers);
+
+    const double wall = elapsed();
+    stream << std::fixed << std::setprecision(3)
+           << "{\"progress_ms\": " << wall * 1e3
+           << ", \"files\": " << counters[files] << ", \"directories\": " << counters[directories]
+           << ", \"bytes\": " << counters[bytes] << ", \"lines\": " << counters[lines]
+           << ", \"bytes_per_s\": " << (wall > 0 ? counters[bytes] / wall : 0.0)
+           << "}" << std::defaultfloat << std::endl;
+}
+
+// PROTECTED:
+void Stats::sum(uint64_t (&counters)[counters_number], uint64_t (&timers)[timers_number]) const
+{
+    for (size_t i = 0; i < counters_number; ++i) { counters[i] = 0; }
+    for (size_t i = 0; i < timers_number; ++i) { timers[i] = 0; }
+    for (const auto& thread : threads)
+    {
+        for (size_t i = 0; i < counters_number; ++i) { counters[i] += thread->counters[i].load(std::memory_order_relaxed); }
+        for (size_t i = 0; i < timers_number; ++i) { timers[i] += thread->timers[i].load(std::memory_order_relaxed); }
+    }
+}
+
+double Stats::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+// PRIVATE:
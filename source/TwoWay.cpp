@@ -0,0 +1,113 @@
+#include "TwoWay.hpp"
+#include "CaseFold.hpp"
+#include <cstring>
+#include <algorithm>
+
+// Вычисление максимального суффикса образца для прямого (reversed = false) или обратного порядка байтов.
+// Возвращает позицию перед началом суффикса (SIZE_MAX - перед началом образца) и его период.
+static size_t maximal_suffix(const std::string& pattern, bool reversed, size_t& period)
+{
+    const size_t size = pattern.size();
+    size_t suffix = SIZE_MAX; // Позиция перед началом текущего максимального суффикса.
+    size_t j = 0;
+    size_t k = 1;
+    period = 1;
+    while (j + k < size)
+    {
+        const unsigned char a = pattern[j + k];
+        const unsigned char b = pattern[suffix + k];
+        if (reversed ? (b < a) : (a < b))
+        {
+            j += k;
+            k = 1;
+            period = j - suffix;
+        }
+        else if (a == b)
+        {
+            if (k != period) { ++k; }
+            else
+            {
+                j += period;
+                k = 1;
+            }
+        }
+        else
+        {
+            suffix = j++;
+            k = period = 1;
+        }
+    }
+    return suffix;
+}
+
+////////////////     TwoWay     ////////////////
+// Класс, реализующий алгоритм Крошмора-Перрена.
+// PUBLIC:
+TwoWay::TwoWay(const std::string& init_string, bool init_case_insensitive)
+{
+    pattern = init_string;
+    case_insensitive = init_case_insensitive;
+    if (case_insensitive)
+    {
+        for (char& ch : pattern) { ch = CaseFold::fold_ascii(ch); }
+    }
+
+    // Критическая позиция - большая из позиций максимальных суффиксов для двух порядков байтов.
+    size_t direct_period;
+    size_t reversed_period;
+    const size_t direct = maximal_suffix(pattern, false, direct_period) + 1;
+    const size_t reversed = maximal_suffix(pattern, true, reversed_period) + 1;
+    critical = std::max(direct, reversed);
+    period = (direct >= reversed) ? direct_period : reversed_period;
+
+    // Если левая часть повторяется с найденным периодом, он является периодом всего образца; иначе
+    // после совпадения окно можно сдвинуть дальше, не пропустив вхождений.
+    periodic = (critical + period <= pattern.size()) && std::memcmp(pattern.data(), pattern.data() + period, critical) == 0;
+    if (!periodic) { period = std::max(critical, pattern.size() - critical) + 1; }
+}
+
+void TwoWay::search(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    if (case_insensitive) { search_loop<true>(begin, end, entries); }
+    else { search_loop<false>(begin, end, entries); }
+}
+
+// PROTECTED:
+template <bool fold>
+void TwoWay::search_loop(const char* begin, const char* end, std::vector<Searcher::Entry>& entries) const
+{
+    const size_t size = pattern.size();
+    const size_t length = end - begin;
+    if (!size || length < size) { return; }
+
+    auto equal = [this](size_t i, char ch)
+    { return static_cast<unsigned char>(pattern[i]) == (fold ? CaseFold::fold_ascii(ch) : static_cast<unsigned char>(ch)); };
+
+    LineTracker lines(begin, end, entries, limits);
+    size_t memory = 0; // Длина префикса образца, совпадение с которым известно после предыдущего сдвига.
+    for (size_t j = 0; j <= length - size;)
+    {
+        // Сравнение правой части.
+        size_t i = std::max(critical, memory);
+        while (i < size && equal(i, begin[i + j])) { ++i; }
+        if (i < size)
+        {
+            j += i - critical + 1;
+            memory = 0;
+            continue;
+        }
+
+        // Сравнение левой части справа налево (до известного совпавшего префикса).
+        i = critical;
+        while (i > memory && equal(i - 1, begin[i - 1 + j])) { --i; }
+        if (i <= memory)
+        {
+            lines.add(begin + j + size - 1);
+            if (lines.full()) { break; }
+        }
+        j += period;
+        memory = periodic ? size - period : 0;
+    }
+}
+
+// PRIVATE:
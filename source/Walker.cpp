@@ -1,159 +1,900 @@
 #include "Walker.hpp"
+#include "Cpu.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
 //#define DEBUG_OUTPUT_WALKER_WALK
 
+// Замер длительности этапа в счётчик потока. Счётчики нужны только для подбора числа активных потоков.
+class StageTimer
+{
+public:
+    StageTimer(std::atomic<uint64_t>& init_counter, bool enabled) : counter(enabled ? &init_counter : nullptr)
+    {
+        if (counter) { started = std::chrono::steady_clock::now(); }
+    }
+
+    ~StageTimer()
+    {
+        if (!counter) { return; }
+        const auto duration = std::chrono::steady_clock::now() - started;
+        counter->fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+    }
+
+    StageTimer(StageTimer&& other) = delete;
+    StageTimer(const StageTimer& other) = delete;
+    StageTimer& operator =(StageTimer&& other) = delete;
+    StageTimer& operator =(const StageTimer& other) = delete;
+
+protected:
+    std::atomic<uint64_t>* counter;                // Счётчик потока (nullptr - замер не выполняется).
+    std::chrono::steady_clock::time_point started; // Начало этапа.
+
+private:
+
+};
+
+// Запись каталога, возвращаемая системным вызовом getdents64.
+struct linux_dirent64
+{
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1]; // Имя переменной длины, завершённое нулём (запись занимает d_reclen байт).
+};
+
 ////////////////     Walker     ////////////////
 // Класс для рекурсивного параллельного поиска.
 // PUBLIC:
-Walker::Walker(std::shared_ptr<Searcher> init_searcher)
+Walker::Walker(std::shared_ptr<Searcher> init_searcher, std::shared_ptr<Output> init_output, size_t init_threads_number) :
+    Walker(init_searcher, init_output, init_threads_number, Options())
+{}
+
+Walker::Walker(std::shared_ptr<Searcher> init_searcher, std::shared_ptr<Output> init_output, size_t init_threads_number, const Options& init_options) :
+    files(files_capacity)
 {
     searcher = init_searcher;
+    output = init_output;
+    options = init_options;
+    const size_t threads_number = std::max<size_t>(init_threads_number, 1);
+
+    // При подборе числа потоков сначала активны options.active_threads потоков, остальные ожидают.
+    const size_t active = (options.adaptive && options.active_threads) ? std::min(options.active_threads, threads_number) : threads_number;
+    active_threads = active;
+    min_active_threads = active;
+
+    // Без io_uring чтения выполняет общий пул потоков; блокирующих чтений в нём больше, чем рабочих потоков.
+    // Объём буфферов чтения делится между потоками, поэтому не растёт с их числом.
+    read_memory = options.read_memory / threads_number;
+    if (options.read_backend == Reader::Backend::threads) { read_pool = std::make_shared<ReadPool>(std::max<size_t>(4, 2 * threads_number)); }
+    // Блоки распакованных данных общие: при большом числе потоков распаковка ждёт свободного блока.
+    if (options.decompress)
+    {
+        const size_t block_size = decompress_block_size;
+        const size_t blocks_number = std::min(options.decompress_memory / block_size, 3 * threads_number);
+        decompress_pool = std::make_shared<BlockPool>(block_size, blocks_number);
+    }
+    for (size_t i = 0; i < threads_number; ++i)
+    {
+        directory_queues.push_back(std::make_unique<DirectoryQueue>());
+        workers.push_back(std::make_unique<Worker>(*output));
+        if (options.stats) { workers.back()->stats = options.stats->thread(i); }
+        if (options.read_backend != Reader::Backend::none)
+        {
+            Worker& worker = *workers.back();
+            worker.reader = std::make_unique<Reader>(options.read_backend, read_pool, options.read_depth, read_memory);
+            if (worker.reader->get_backend() == Reader::Backend::none) { worker.reader.reset(); }
+        }
+    }
 }
 
-void Walker::walk(std::filesystem::path& walk_path, bool recursively)
+void Walker::walk(const std::filesystem::path& walk_path, bool init_recursively)
 {
-    walking.store(true);
-    std::vector<std::filesystem::path> buffer;
+    recursively = init_recursively;
+
+    // Начальный путь может указывать на отдельный файл.
+    std::error_code error;
+    if (std::filesystem::is_directory(walk_path, error))
+    {
+        Directory root{walk_path, nullptr};
+        if (options.filter)
+        {
+            root.ignore = options.filter->root(walk_path.native());
+            struct stat status;
+            if (options.filter->get_options().follow_links && !stat(walk_path.c_str(), &status)) { visit(status); }
+        }
+        ++pending;
+        push_directory(0, std::move(root));
+    }
+    else
+    {
+        struct stat status = {};
+        stat(walk_path.c_str(), &status);
+        if (options.filter && !options.filter->fits(status.st_size)) { return; }
+        std::vector<Task> buffer;
+        add_file(buffer, std::filesystem::path(walk_path), status);
+        push_files(buffer, *workers[0]);
+    }
 
     #ifdef DEBUG_OUTPUT_WALKER_WALK
-    std::cout << "Обнаруженные файлы: " << std::endl;
+    std::cout << "Начальный путь: " << walk_path << std::endl;
     #endif
+}
 
-    // TODO: сделать что-то с этим тупым копипастом кода.
-    // Рекурсивный обход директори.
-    if (recursively)
+void Walker::walk(const std::vector<std::filesystem::path>& paths)
+{
+    recursively = false;
+
+    // Список не помещается в ограниченную очередь файлов до запуска потоков: его части по list_part_size
+    // файлов распределяются по очередям директорий потоков, и файлы проверяются и добавляются в очередь
+    // уже во время поиска.
+    auto list = std::make_shared<const std::vector<std::filesystem::path>>(paths);
+    const size_t part_size = list_part_size;
+    for (size_t begin = 0, part = 0; begin < list->size(); begin += part_size, ++part)
     {
-        for (auto& path: std::filesystem::recursive_directory_iterator(walk_path))
+        Directory directory;
+        directory.list = list;
+        directory.begin = begin;
+        directory.end = std::min(begin + part_size, list->size());
+        ++pending;
+        push_directory(part % directory_queues.size(), std::move(directory));
+    }
+}
+
+void Walker::search(size_t thread_index)
+{
+    if (!options.cores.empty()) { Cpu::pin(options.cores, thread_index); }
+
+    Worker& worker = *workers[thread_index];
+    std::vector<Task> buffer;
+    Directory directory;
+    while (true)
+    {
+        // Неактивный поток ожидает, пока число активных потоков не вырастет или работа не закончится.
+        if (thread_index >= active_threads.load(std::memory_order_relaxed))
         {
-            // Проверка, является ли найденный файл обычным.
-            if (std::filesystem::is_regular_file(path))
+            if (!pending.load()) { break; }
+            worker.arena.flush();
+            rest(thread_index);
+            continue;
+        }
+
+        // В первую очередь обрабатываются уже найденные файлы: поток забирает файлы суммарным
+        // размером до search_max_buffer_size.
+        {
+            const size_t max_buffer_size = search_max_buffer_size.load(std::memory_order_relaxed);
+            size_t current_buffer_size = 0;
+            Task task;
+            while (current_buffer_size <= max_buffer_size && files.try_pop(task))
             {
-                // Добавление файла в буффер.
-                #ifdef DEBUG_OUTPUT_WALKER_WALK
-                std::cout << path << std::endl;
-                #endif
-                buffer.push_back(path);
+                current_buffer_size += task.size;
+                buffer.push_back(std::move(task));
+            }
+        }
+        if (!buffer.empty())
+        {
+            search_batch(buffer, worker);
+            finish(buffer.size());
+            buffer.clear();
+            adapt();
+            continue;
+        }
 
-                // Если буффер наполнился, происходит его сброс в общую очередь.
-                if (buffer.size() >= walk_buffer_size)
-                {
-                    std::unique_lock<std::shared_mutex> lock(mutex_files);
-                    for (auto& iter: buffer) { files.push(iter); }
-                    buffer.clear();
-                    condition_files.notify_all(); // Оповещение, что в очередь добавлены новые файлы.
-                }
+        // Затем - директории из своей очереди или украденные у других потоков.
+        if (pop_directory(thread_index, directory))
+        {
+            if (!stopped.load(std::memory_order_relaxed))
+            {
+                if (directory.list) { enumerate_list(directory, thread_index); }
+                else { enumerate(directory, thread_index); }
             }
+            finish(1);
+            adapt();
+            continue;
         }
+
+        // Если работы нет, поток ожидает её появления или завершения обхода.
+        if (!pending.load()) { break; }
+        worker.arena.flush();
+        PSEARCH_STATS_SCOPE(worker.stats, queue_wait);
+        park();
     }
-    // Нерекурсивный обход директории.
-    else
+
+    worker.arena.flush();
+}
+
+// PROTECTED:
+void Walker::enumerate(const Directory& directory, size_t thread_index)
+{
+    [[maybe_unused]] Stats::Thread* stats = workers[thread_index]->stats;
+    PSEARCH_STATS_ADD(stats, directories, 1);
+
+    int descriptor = openat(AT_FDCWD, directory.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (descriptor < 0) { return; }
+
+    // Правила .gitignore и .ignore директории дополняют правила родительских директорий.
+    const Filter* filter = options.filter.get();
+    std::shared_ptr<const Filter::Ignore> ignore;
+    if (filter)
+    {
+        PSEARCH_STATS_SCOPE(stats, traversal);
+        ignore = filter->enter(directory.path.native(), descriptor, directory.ignore);
+    }
+    const bool follow_links = filter && filter->get_options().follow_links;
+
+    std::vector<Task> buffer;
+    alignas(linux_dirent64) char entries_buffer[32 * 1024];
+    while (!stopped.load(std::memory_order_relaxed))
     {
-        for (auto& path: std::filesystem::directory_iterator(walk_path))
+        long count;
+        {
+            PSEARCH_STATS_SCOPE(stats, traversal);
+            count = syscall(SYS_getdents64, descriptor, entries_buffer, sizeof(entries_buffer));
+        }
+        if (count <= 0) { break; }
+
+        for (long offset = 0; offset < count;)
         {
-            // Проверка, является ли найденный файл обычным.
-            if (std::filesystem::is_regular_file(path))
+            const linux_dirent64* entry = reinterpret_cast<const linux_dirent64*>(entries_buffer + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (!std::strcmp(name, ".") || !std::strcmp(name, "..")) { continue; }
+
+            // Тип записи известен из d_type; для символических ссылок и неизвестных типов выполняется stat
+            // (ссылки на обычные файлы обрабатываются, на директории - обходятся только при follow_links).
+            // Размер файла определяется относительно открытой директории, без разбора полного пути.
+            unsigned char type = entry->d_type;
+            struct stat status;
+            bool status_known = false;
+            if (type == DT_UNKNOWN)
+            {
+                PSEARCH_STATS_ADD(stats, stat_calls, 1);
+                if (fstatat(descriptor, name, &status, AT_SYMLINK_NOFOLLOW)) { continue; }
+                status_known = true;
+                if (S_ISDIR(status.st_mode)) { type = DT_DIR; }
+                else if (S_ISREG(status.st_mode)) { type = DT_REG; }
+                else if (S_ISLNK(status.st_mode)) { type = DT_LNK; }
+            }
+            if (type == DT_LNK)
+            {
+                PSEARCH_STATS_ADD(stats, stat_calls, 1);
+                if (fstatat(descriptor, name, &status, 0)) { continue; }
+                status_known = true;
+                if (S_ISREG(status.st_mode)) { type = DT_REG; }
+                else if (S_ISDIR(status.st_mode) && follow_links) { type = DT_DIR; }
+                else { continue; }
+            }
+            if (!(type == DT_DIR && recursively) && type != DT_REG) { continue; }
+
+            // Отфильтрованные директории не обходятся, и их содержимое не читается.
+            std::filesystem::path path = directory.path / name;
+            if (filter && !filter->allows(path.native(), name, type == DT_DIR, *ignore))
+            {
+                PSEARCH_STATS_ADD(stats, filtered, 1);
+                continue;
+            }
+
+            if (type == DT_DIR)
             {
-                // Добавление файла в буффер.
+                // При обходе по символическим ссылкам каждая директория обходится один раз: так исключаются
+                // циклы и повторный обход одного поддерева по разным путям.
+                if (follow_links)
+                {
+                    if (!status_known)
+                    {
+                        PSEARCH_STATS_ADD(stats, stat_calls, 1);
+                        if (fstatat(descriptor, name, &status, 0)) { continue; }
+                    }
+                    if (!visit(status)) { continue; }
+                }
+                ++pending;
+                push_directory(thread_index, Directory{std::move(path), ignore});
+            }
+            else
+            {
+                if (!status_known)
+                {
+                    PSEARCH_STATS_ADD(stats, stat_calls, 1);
+                    if (fstatat(descriptor, name, &status, AT_SYMLINK_NOFOLLOW)) { continue; }
+                }
+                if (filter && !filter->fits(status.st_size))
+                {
+                    PSEARCH_STATS_ADD(stats, filtered, 1);
+                    continue;
+                }
+
                 #ifdef DEBUG_OUTPUT_WALKER_WALK
                 std::cout << path << std::endl;
                 #endif
-                buffer.push_back(path);
+                add_file(buffer, std::move(path), status);
 
                 // Если буффер наполнился, происходит его сброс в общую очередь.
-                if (buffer.size() >= walk_buffer_size)
-                {
-                    std::unique_lock<std::shared_mutex> lock(mutex_files);
-                    for (auto& iter: buffer) { files.push(iter); }
-                    buffer.clear();
-                    condition_files.notify_all(); // Оповещение, что в очередь добавлены новые файлы.
-                }
+                if (buffer.size() >= walk_buffer_size.load(std::memory_order_relaxed)) { push_files(buffer, *workers[thread_index]); }
             }
         }
     }
+    close(descriptor);
 
     // Сброс остатка буффера в очередь.
+    if (!buffer.empty()) { push_files(buffer, *workers[thread_index]); }
+}
+
+void Walker::enumerate_list(const Directory& part, size_t thread_index)
+{
+    [[maybe_unused]] Stats::Thread* stats = workers[thread_index]->stats;
+    std::vector<Task> buffer;
+    for (size_t i = part.begin; i < part.end && !stopped.load(std::memory_order_relaxed); ++i)
     {
-        std::unique_lock<std::shared_mutex> lock(mutex_files);
-        for (auto& iter: buffer) { files.push(iter); }
-        buffer.clear();
-        condition_files.notify_all(); // Оповещение, что в очередь добавлены новые файлы.
+        const std::filesystem::path& path = (*part.list)[i];
+        struct stat status;
+        PSEARCH_STATS_ADD(stats, stat_calls, 1);
+        if (stat(path.c_str(), &status)) { continue; }
+        if (options.filter && !options.filter->fits(status.st_size))
+        {
+            PSEARCH_STATS_ADD(stats, filtered, 1);
+            continue;
+        }
+        add_file(buffer, std::filesystem::path(path), status);
     }
+    if (!buffer.empty()) { push_files(buffer, *workers[thread_index]); }
+}
 
-    // Оповещение об окончании обхода.
-    walking.store(false);
-    condition_files.notify_all();
+bool Walker::pop_directory(size_t thread_index, Directory& directory)
+{
+    [[maybe_unused]] Stats::Thread* stats = workers[thread_index]->stats;
+    PSEARCH_STATS_SCOPE(stats, directory_lock);
 
-    #ifdef DEBUG_OUTPUT_WALKER_WALK
-    std::cout << "Обход завершён. " << std::endl;
-    #endif
+    // Своя очередь: директория с конца (обход в глубину, лучшая локальность).
+    {
+        DirectoryQueue& own = *directory_queues[thread_index];
+        std::unique_lock<std::mutex> lock(own.mutex);
+        if (!own.directories.empty())
+        {
+            directory = std::move(own.directories.back());
+            own.directories.pop_back();
+            --queued_directories;
+            return true;
+        }
+    }
+
+    // Кража из очередей других потоков: директория с начала (ближе к корню, больше работы).
+    for (size_t i = 1; i < directory_queues.size(); ++i)
+    {
+        DirectoryQueue& other = *directory_queues[(thread_index + i) % directory_queues.size()];
+        std::unique_lock<std::mutex> lock(other.mutex);
+        if (!other.directories.empty())
+        {
+            directory = std::move(other.directories.front());
+            other.directories.pop_front();
+            --queued_directories;
+            PSEARCH_STATS_ADD(stats, steals, 1);
+            return true;
+        }
+    }
+    return false;
 }
 
-void Walker::search()
+void Walker::push_directory(size_t thread_index, Directory&& directory)
 {
-    std::vector<Searcher::Entry> entries;
-    std::queue<std::filesystem::path> buffer;
-    while (true)
+    ++queued_directories;
+    {
+        DirectoryQueue& own = *directory_queues[thread_index];
+        std::unique_lock<std::mutex> lock(own.mutex);
+        own.directories.push_back(std::move(directory));
+    }
+    wake(false);
+}
+
+bool Walker::visit(const struct stat& status)
+{
+    std::unique_lock<std::mutex> lock(mutex_visited);
+    return visited.emplace(static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino)).second;
+}
+
+void Walker::add_file(std::vector<Task>& buffer, std::filesystem::path&& path, const struct stat& status)
+{
+    const uintmax_t size = status.st_size;
+    const ResultCache::Stamp stamp{static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino),
+                                   static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec, size};
+
+    // При использовании кэша файл, доступный по нескольким путям (жёсткие ссылки), обрабатывается один раз,
+    // а файлы с актуальной записью в кэше не делятся на части.
+    bool cached = false;
+    if (options.cache)
     {
-        while (true)
+        if (!options.cache->claim(stamp)) { return; }
+        cached = options.cache->contains(stamp);
+    }
+
+    // Большие файлы делятся на части, если совпадения не могут пересекать границы строк.
+    if (cached || !options.chunk_size || size <= options.chunk_size || searcher->crosses_lines())
+    {
+        buffer.push_back(Task{std::move(path), size, nullptr, 0, stamp});
+        return;
+    }
+
+    std::shared_ptr<FileJob> job = std::make_shared<FileJob>();
+    job->path = path;
+    job->chunks_number = (size + options.chunk_size - 1) / options.chunk_size;
+    job->chunk_entries.resize(job->chunks_number);
+    job->chunk_lines.resize(job->chunks_number, 0);
+    job->remaining = job->chunks_number;
+    for (size_t chunk = 0; chunk < job->chunks_number; ++chunk)
+    { buffer.push_back(Task{path, std::min(options.chunk_size, size - chunk * options.chunk_size), job, chunk, stamp}); }
+}
+
+void Walker::push_files(std::vector<Task>& buffer, Worker& worker)
+{
+    // После достижения ограничения числа результатов новые файлы не добавляются.
+    if (stopped.load(std::memory_order_relaxed))
+    {
+        buffer.clear();
+        return;
+    }
+
+    pending += buffer.size();
+    for (Task& task : buffer)
+    {
+        // Если очередь заполнена, производитель сам обрабатывает файлы из очереди, пока не освободится место.
+        while (!files.try_push(task))
         {
+            Task other;
+            if (files.try_pop(other))
             {
-                size_t current_buffer_size = 0;
-                std::unique_lock<std::shared_mutex> lock(mutex_files);
-
-                // При непустой очереди следует начать заполнение буффера файлами.
-                if (!files.empty())
-                {
-                    // Заполнение буффера.
-                    while (!files.empty() && current_buffer_size <= search_max_buffer_size)
-                    {
-                        buffer.push(files.front());
-                        files.pop();
-                        current_buffer_size += std::filesystem::file_size(buffer.back());
-                    }
-                }
-                else
-                { break; }
+                search_task(other, worker);
+                finish(1);
             }
+            else { std::this_thread::yield(); }
+        }
+    }
+    buffer.clear();
+    wake(true); // Оповещение, что в очередь добавлены новые файлы.
+}
+
+bool Walker::has_work() const
+{
+    return !files.empty() || queued_directories.load() || !pending.load();
+}
+
+void Walker::search_batch(const std::vector<Task>& batch, Worker& worker)
+{
+    if (!worker.reader)
+    {
+        for (const Task& task : batch) { search_task(task, worker); }
+        return;
+    }
 
-            while (!buffer.empty())
+    // Чтения файлов пакета ставятся в очередь заранее: пока идёт поиск в текущем файле, следующие уже
+    // читаются. Очередь пополняется перед каждым файлом, пока в ней и в пуле буфферов есть место;
+    // файлы, не поставленные в очередь, обрабатываются синхронно.
+    std::vector<bool> reading(batch.size(), false);
+    size_t next = 0;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        for (next = std::max(next, i); next < batch.size() && !stopped.load(std::memory_order_relaxed); ++next)
+        {
+            if (!prefetchable(batch[next])) { continue; }
+            if (!worker.reader->submit(batch[next].path.c_str(), batch[next].size, next)) { break; }
+            reading[next] = true;
+            PSEARCH_STATS_ADD(worker.stats, async_reads, 1);
+        }
+        worker.reader->flush();
+
+        if (reading[i]) { search_read(batch[i], worker, i); }
+        else { search_task(batch[i], worker); }
+    }
+}
+
+bool Walker::prefetchable(const Task& task) const
+{
+    return !task.job && task.size && task.size <= read_memory / 4 && !(options.cache && options.cache->contains(task.stamp));
+}
+
+void Walker::search_task(const Task& task, Worker& worker)
+{
+    // После достижения ограничения числа результатов оставшиеся задачи только снимаются с учёта.
+    if (stopped.load(std::memory_order_relaxed)) { return; }
+    if (task.job) { search_chunk(task, worker); }
+    else { search_file(task, worker); }
+}
+
+void Walker::search_file(const Task& task, Worker& worker)
+{
+    // Результат для неизменённого файла берётся из кэша.
+    if (options.cache && options.cache->lookup(task.stamp, worker.entries))
+    {
+        PSEARCH_STATS_ADD(worker.stats, cache_hits, 1);
+        print_file(task.path, worker);
+        return;
+    }
+
+    std::optional<FileView> file_view;
+    {
+        PSEARCH_STATS_SCOPE(worker.stats, io);
+        StageTimer timer(worker.io_time, options.adaptive);
+        file_view.emplace(task.path);
+    }
+    StageTimer timer(worker.scan_time, options.adaptive);
+    scan_file(task, worker, file_view->begin(), file_view->size(), file_view->is_open());
+}
+
+void Walker::search_read(const Task& task, Worker& worker, uint64_t tag)
+{
+    Reader::Read read;
+    {
+        PSEARCH_STATS_SCOPE(worker.stats, io);
+        StageTimer timer(worker.io_time, options.adaptive);
+        read = worker.reader->wait(tag);
+    }
+
+    // После достижения ограничения числа результатов прочитанный файл только освобождается.
+    if (!stopped.load(std::memory_order_relaxed))
+    {
+        StageTimer timer(worker.scan_time, options.adaptive);
+        scan_file(task, worker, read.data, read.size, read.opened);
+    }
+    worker.reader->release(tag);
+}
+
+void Walker::scan_file(const Task& task, Worker& worker, const char* data, size_t size, bool opened)
+{
+    // Двоичный файл определяется по первому блоку и не просматривается; пустой результат сохраняется в кэше.
+    // Сжатый файл проверяется на двоичность после распаковки.
+    const Decompressor::Format format = options.decompress ? Decompressor::detect(data, size) : Decompressor::Format::none;
+    if (format != Decompressor::Format::none)
+    { scan_compressed(worker, format, data, size, worker.entries, worker.kept); }
+    else if (options.filter && options.filter->skips(data, size))
+    { PSEARCH_STATS_ADD(worker.stats, binary_files, 1); }
+    else
+    {
+        {
+            PSEARCH_STATS_SCOPE(worker.stats, scan);
+            searcher->search(data, data + size, worker.entries);
+        }
+        PSEARCH_STATS_ADD(worker.stats, files, 1);
+        PSEARCH_STATS_ADD(worker.stats, bytes, size);
+    }
+    if (options.cache && opened) { options.cache->store(task.stamp, worker.entries); }
+
+    print_file(task.path, worker);
+}
+
+void Walker::scan_compressed(Worker& worker, Decompressor::Format format, const char* data, size_t size,
+                             std::vector<Searcher::Entry>& entries, std::deque<std::string>& kept)
+{
+    if (!worker.decompressor) { worker.decompressor = std::make_unique<Decompressor>(decompress_pool); }
+    Decompressor& decompressor = *worker.decompressor;
+    decompressor.start(format, data, data + size);
+
+    // Номера строк в блоке сдвигаются на число строк в предшествующих блоках.
+    const Searcher::Limits& limits = searcher->get_limits();
+    const size_t max_lines = limits.max_lines ? limits.max_lines : SIZE_MAX;
+    size_t line_offset = 0;
+    size_t bytes = 0;
+    // Блоки возвращаются в пул до вывода, поэтому строки вхождений копируются в страницы kept.
+    auto scan = [this, &worker, &entries, &kept, &limits, &line_offset, &bytes](const char* begin, const char* end)
+    {
+        PSEARCH_STATS_SCOPE(worker.stats, scan);
+        const size_t before = entries.size();
+        searcher->search(begin, end, entries);
+        for (size_t i = before; i < entries.size(); ++i)
+        {
+            entries[i].line_number += line_offset;
+            std::string_view& line = entries[i].line;
+            if (kept.empty() || kept.back().capacity() - kept.back().size() < line.size())
             {
-                std::filesystem::path current_file = buffer.front();
-                std::ifstream file_stream(current_file);
-                searcher->search(file_stream, entries);
-                buffer.pop();
+                kept.emplace_back();
+                kept.back().reserve(line.size() > kept_page_size ? line.size() : kept_page_size);
+            }
+            std::string& page = kept.back();
+            page.append(line);
+            line = std::string_view(page.data() + page.size() - line.size(), line.size());
+        }
+        if (limits.copy_lines) { line_offset += std::count(begin, end, '\n'); }
+        bytes += end - begin;
+    };
 
-                if (!entries.empty())
-                {
-                    std::unique_lock<std::mutex> lock(mutex_output);
-                    for (auto entry : entries)
-                    { std::cout << current_file << "\t " << entry.line_number << ": " << entry.line << std::endl; }
-                    entries.clear();
-                }
+    // В блоке просматриваются целые строки; незаконченная последняя строка переносится в следующий блок.
+    // Совпадения, которые могут содержать перевод строки, ищутся в распакованном файле целиком.
+    std::string carry;
+    bool binary = false;
+    bool first = true;
+    while (entries.size() < max_lines && !stopped.load(std::memory_order_relaxed))
+    {
+        BlockPool::Block* block = decompressor.next();
+        if (!block) { break; }
+        const char* begin = block->data.get();
+        const char* end = begin + block->size;
+        if (first)
+        {
+            first = false;
+            binary = options.filter && options.filter->skips(begin, block->size);
+            if (binary)
+            {
+                decompressor.release(block);
+                break;
             }
         }
 
+        const char* last = searcher->crosses_lines() ? nullptr : static_cast<const char*>(memrchr(begin, '\n', end - begin));
+        if (!last) { carry.append(begin, end); }
+        else
         {
-            bool wait = false;
+            if (!carry.empty())
             {
-                std::shared_lock<std::shared_mutex> lock(mutex_files);
-                if (files.empty())
-                {
-                    // Если очередь пустая, а обхода нет, цикл завершается.
-                    if (!walking.load()) { break; }
-                    else { wait = true; }
-                }
+                const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                carry.append(begin, newline + 1);
+                scan(carry.data(), carry.data() + carry.size());
+                carry.clear();
+                begin = newline + 1;
             }
-            if (wait)
+            if (begin <= last) { scan(begin, last + 1); }
+            carry.assign(last + 1, end);
+        }
+        decompressor.release(block);
+    }
+    if (!binary && !carry.empty() && entries.size() < max_lines) { scan(carry.data(), carry.data() + carry.size()); }
+    decompressor.finish();
+
+    // Ограничение числа строк в файле применяется к каждому диапазону, поэтому лишние строки отбрасываются.
+    if (entries.size() > max_lines) { entries.erase(entries.begin() + max_lines, entries.end()); }
+    if (binary) { PSEARCH_STATS_ADD(worker.stats, binary_files, 1); }
+    else
+    {
+        PSEARCH_STATS_ADD(worker.stats, files, 1);
+        PSEARCH_STATS_ADD(worker.stats, compressed, 1);
+        PSEARCH_STATS_ADD(worker.stats, bytes, bytes);
+    }
+}
+
+void Walker::cancel()
+{
+    cancelled = true;
+    stopped = true;
+    wake(true);
+}
+
+void Walker::print_file(const std::filesystem::path& path, Worker& worker)
+{
+    // Если вывод закрыт (например, читатель канала завершился), поиск отменяется. После отмены
+    // вхождения просмотренных файлов не выводятся.
+    if (output->is_closed() && !cancelled.load(std::memory_order_relaxed)) { cancel(); }
+    if (cancelled.load(std::memory_order_relaxed)) { worker.entries.clear(); }
+    if (!worker.entries.empty())
+    {
+        // Пути выводятся без начала options.strip_prefix.
+        const bool strip = !options.strip_prefix.empty() && !path.native().compare(0, options.strip_prefix.size(), options.strip_prefix);
+        const std::filesystem::path stripped = strip ? path.native().substr(options.strip_prefix.size()) : std::string();
+        const std::filesystem::path& shown = strip ? stripped : path;
+        count_entries(worker, worker.entries);
+        PSEARCH_STATS_SCOPE(worker.stats, output);
+        if (output->get_mode() == Output::Mode::lines)
+        {
+            // При общем ограничении выводится не больше оставшегося числа строк.
+            const size_t allowed = reserve(worker.entries.size());
+            worker.entries.erase(worker.entries.begin() + allowed, worker.entries.end());
+            if (allowed) { worker.arena.add(shown, worker.entries, *searcher); }
+        }
+        else if (reserve(1))
+        { worker.arena.add_file(shown, worker.entries); }
+        worker.arena.end_file(shown);
+        worker.entries.clear();
+    }
+    worker.kept.clear();
+}
+
+void Walker::search_chunk(const Task& task, Worker& worker)
+{
+    FileJob& job = *task.job;
+    std::call_once(job.open_flag, [this, &job, &worker]()
+    {
+        PSEARCH_STATS_SCOPE(worker.stats, io);
+        StageTimer timer(worker.io_time, options.adaptive);
+        job.view = std::make_unique<FileView>(job.path);
+
+        // Двоичный файл определяется по первому блоку; части такого файла только снимаются с учёта.
+        // Сжатый файл не делится на части: его целиком распаковывает поток первой части.
+        if (options.decompress) { job.format = Decompressor::detect(job.view->begin(), job.view->size()); }
+        if (job.format != Decompressor::Format::none) { return; }
+        job.binary = options.filter && options.filter->skips(job.view->begin(), job.view->size());
+        if (job.binary) { PSEARCH_STATS_ADD(worker.stats, binary_files, 1); }
+    });
+
+    // Номинальные границы частей сдвигаются к началу следующей строки. Соседние части вычисляют общую
+    // границу одинаково, поэтому части не пересекаются и покрывают весь файл.
+    const char* data = job.view->begin();
+    const size_t size = job.view->size();
+    const size_t chunk_size = options.chunk_size;
+    auto align = [data, size](size_t offset)
+    {
+        if (offset == 0) { return static_cast<size_t>(0); }
+        if (offset >= size) { return size; }
+        const void* newline = std::memchr(data + offset - 1, '\n', size - offset + 1);
+        return newline ? static_cast<const char*>(newline) - data + 1 : size;
+    };
+    const size_t begin = align(task.chunk * chunk_size);
+    const size_t end = (task.chunk + 1 == job.chunks_number) ? size : align((task.chunk + 1) * chunk_size);
+
+    const bool compressed = job.format != Decompressor::Format::none;
+    StageTimer timer(worker.scan_time, options.adaptive);
+    if (compressed)
+    {
+        if (task.chunk == 0) { scan_compressed(worker, job.format, data, size, job.chunk_entries[0], job.kept); }
+    }
+    else if (!job.binary)
+    {
+        PSEARCH_STATS_ADD(worker.stats, chunks, 1);
+        PSEARCH_STATS_ADD(worker.stats, bytes, end - begin);
+    }
+    if (begin < end && !job.binary && !compressed)
+    {
+        PSEARCH_STATS_SCOPE(worker.stats, scan);
+        searcher->search(data + begin, data + end, job.chunk_entries[task.chunk]);
+        if (task.chunk + 1 != job.chunks_number && searcher->get_limits().copy_lines)
+        { job.chunk_lines[task.chunk] = std::count(data + begin, data + end, '\n'); }
+    }
+
+    // Последний завершивший поток собирает вхождения по порядку, сдвигая номера строк на число строк
+    // в предшествующих частях, и выводит их как вхождения целого файла.
+    if (job.remaining.fetch_sub(1) == 1)
+    {
+        if (!job.binary && !compressed) { PSEARCH_STATS_ADD(worker.stats, files, 1); }
+        size_t line_offset = 0;
+        for (size_t chunk = 0; chunk < job.chunks_number; ++chunk)
+        {
+            for (Searcher::Entry& entry : job.chunk_entries[chunk])
             {
-                // Если очередь пустая, а обход есть, производится переход в режим ожидания.
-                std::unique_lock<std::mutex> wait_lock(mutex_condition_files);
-                condition_files.wait(wait_lock);
+                worker.entries.push_back(std::move(entry));
+                worker.entries.back().line_number += line_offset;
             }
+            line_offset += job.chunk_lines[chunk];
         }
+
+        // Ограничение числа строк в файле применяется к каждой части, поэтому лишние строки отбрасываются.
+        const size_t max_lines = searcher->get_limits().max_lines;
+        if (max_lines && worker.entries.size() > max_lines)
+        { worker.entries.erase(worker.entries.begin() + max_lines, worker.entries.end()); }
+
+        // Строки вхождений указывают в содержимое файла, поэтому оно освобождается после вывода.
+        if (options.cache && job.view->is_open()) { options.cache->store(task.stamp, worker.entries); }
+        print_file(job.path, worker);
+        job.chunk_entries.clear();
+        job.kept.clear();
+        job.view.reset();
     }
 }
 
-// PROTECTED:
+void Walker::count_entries(Worker& worker, const std::vector<Searcher::Entry>& entries)
+{
+    #ifdef PSEARCH_ENABLE_STATS
+    if (!worker.stats) { return; }
+    worker.stats->add(Stats::lines, entries.size());
+    for (const Searcher::Entry& entry : entries) { worker.stats->add(Stats::matches, entry.entries_number); }
+    #else
+    (void)worker;
+    (void)entries;
+    #endif
+}
+
+size_t Walker::reserve(size_t count)
+{
+    if (!options.max_results) { return count; }
+
+    // Результаты распределяются между потоками атомарно; исчерпавший ограничение поток останавливает поиск.
+    const size_t before = results.fetch_add(count);
+    if (before + count >= options.max_results) { stopped = true; }
+    if (before >= options.max_results) { return 0; }
+    return std::min(count, options.max_results - before);
+}
+
+void Walker::finish(size_t count)
+{
+    // Дочерние директории и файлы учитываются до завершения родителя, поэтому pending обращается в ноль
+    // только после обработки всего дерева.
+    if (pending.fetch_sub(count) == count)
+    {
+        wake(true);
+        resume();
+
+        #ifdef DEBUG_OUTPUT_WALKER_WALK
+        std::cout << "Обход завершён. " << std::endl;
+        #endif
+    }
+}
+
+void Walker::wake(bool all)
+{
+    // Барьер упорядочивает публикацию работы и чтение sleeping (парный барьер - в park): либо
+    // производитель увидит ожидающий поток, либо ожидающий поток увидит новую работу.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!sleeping.load()) { return; }
+
+    // Захват mutex гарантирует, что поток, проверивший условие, уже ожидает и получит оповещение.
+    { std::unique_lock<std::mutex> lock(mutex_sleeping); }
+    if (all) { condition_sleeping.notify_all(); }
+    else { condition_sleeping.notify_one(); }
+}
+
+void Walker::rest(size_t thread_index)
+{
+    std::unique_lock<std::mutex> lock(mutex_sleeping);
+    condition_resting.wait(lock, [this, thread_index]() { return thread_index < active_threads.load() || !pending.load(); });
+}
+
+void Walker::resume()
+{
+    // Захват mutex гарантирует, что поток, проверивший условие, уже ожидает и получит оповещение.
+    { std::unique_lock<std::mutex> lock(mutex_sleeping); }
+    condition_resting.notify_all();
+}
+
+void Walker::adapt()
+{
+    // Подстройку выполняет один поток не чаще раза в adapt_interval.
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < next_adapt.load(std::memory_order_relaxed)) { return; }
+    std::unique_lock<std::mutex> lock(mutex_adapt, std::try_to_lock);
+    if (!lock.owns_lock() || now < next_adapt.load(std::memory_order_relaxed)) { return; }
+    next_adapt = now + std::chrono::duration_cast<std::chrono::nanoseconds>(adapt_interval).count();
+
+    // Пакеты уменьшаются, пока в очереди меньше задач, чем активных потоков, и растут при глубокой очереди.
+    const size_t active = active_threads.load();
+    const size_t depth = files.size() + queued_directories.load();
+    size_t walk_size = walk_buffer_size.load(std::memory_order_relaxed);
+    size_t search_size = search_max_buffer_size.load(std::memory_order_relaxed);
+    if (depth < active)
+    {
+        walk_size = (walk_size / 2 > min_walk_buffer_size) ? walk_size / 2 : min_walk_buffer_size;
+        search_size = (search_size / 2 > min_search_buffer_size) ? search_size / 2 : min_search_buffer_size;
+    }
+    else if (depth > 4 * active)
+    {
+        walk_size = (walk_size * 2 < max_walk_buffer_size) ? walk_size * 2 : max_walk_buffer_size;
+        search_size = (search_size * 2 < max_search_buffer_size) ? search_size * 2 : max_search_buffer_size;
+    }
+    walk_buffer_size.store(walk_size, std::memory_order_relaxed);
+    search_max_buffer_size.store(search_size, std::memory_order_relaxed);
+    if (!options.adaptive) { return; }
+
+    // Число активных потоков растёт, пока чтение занимает больше времени, чем поиск, и работы в очереди
+    // хватает всем потокам: ожидающие чтения потоки не занимают ядер. При поиске, ограниченном процессором,
+    // потоки сверх начального числа только делят ядра и отключаются.
+    uint64_t io_time = 0;
+    uint64_t scan_time = 0;
+    for (const std::unique_ptr<Worker>& worker : workers)
+    {
+        io_time += worker->io_time.load(std::memory_order_relaxed);
+        scan_time += worker->scan_time.load(std::memory_order_relaxed);
+    }
+    const uint64_t io_delta = io_time - last_io_time;
+    const uint64_t scan_delta = scan_time - last_scan_time;
+    last_io_time = io_time;
+    last_scan_time = scan_time;
+    if (io_delta > scan_delta && depth > active && active < workers.size())
+    {
+        active_threads = active + 1;
+        resume();
+    }
+    else if (io_delta * 4 < scan_delta && active > min_active_threads)
+    { active_threads = active - 1; }
+}
+
+void Walker::park()
+{
+    std::unique_lock<std::mutex> lock(mutex_sleeping);
+    ++sleeping;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    condition_sleeping.wait(lock, [this]() { return has_work(); });
+    --sleeping;
+}
 
 // PRIVATE: